@@ -101,6 +101,8 @@ if __name__ == '__main__':
 
   if not any(a.startswith('-Dwith_ssl=') for a in args):
     args.append('-Dwith_ssl=false')
+  if not any(a.startswith('-Dwith_zlib=') for a in args):
+    args.append('-Dwith_zlib=false')
 
   if not any(a.startswith('-Druntime_library=') for a in args):
     args.append('-Druntime_library=default')
@@ -10,6 +10,7 @@
 #include <sstream>
 
 #include "linear/binary.h"
+#include "linear/memory.h"
 #include "linear/optional.h"
 
 namespace linear {
@@ -43,38 +44,37 @@ class any {
   /// @cond hidden
   any() : zone_(), object_(), type(NIL) {
   }
-  any(const any& a) : zone_() {
-    copy_msgpack_object(a.object_, &object_, zone_);
-    type = static_cast<linear::type::any::Type>(object_.type);
+  any(const any& a) : zone_(a.zone_), object_(a.object_), type(a.type) {
   }
   any(const linear::type::nil&) : zone_(), object_(), type(NIL) {
   }
-  any(const msgpack::object& o) : zone_() {
-    copy_msgpack_object(o, &object_, zone_);
-    type = static_cast<linear::type::any::Type>(object_.type);
+  any(const msgpack::object& o) : zone_(), object_(), type(NIL) {
+    assign(o);
+  }
+  any(const msgpack::object& o, const linear::shared_ptr<msgpack::zone>& z)
+    : zone_(z), object_(o), type(static_cast<linear::type::any::Type>(object_.type)) {
   }
   template <typename Value>
-  any(const Value& value) : zone_(), object_(value, zone_), type(static_cast<linear::type::any::Type>(object_.type)) {
+  any(const Value& value) : zone_(new msgpack::zone()), object_(value, *zone_), type(static_cast<linear::type::any::Type>(object_.type)) {
   }
   ~any() {
   }
   template <typename Value>
   any& operator=(const Value& value) {
-    zone_.clear();
-    object_ = msgpack::object(value, zone_);
+    linear::shared_ptr<msgpack::zone> z(new msgpack::zone());
+    object_ = msgpack::object(value, *z);
+    zone_ = z;
     type = static_cast<linear::type::any::Type>(object_.type);
     return *this;
   }
   any& operator=(const any& a) {
-    zone_.clear();
-    copy_msgpack_object(a.object_, &object_, zone_);
-    type = static_cast<linear::type::any::Type>(object_.type);
+    zone_ = a.zone_;
+    object_ = a.object_;
+    type = a.type;
     return *this;
   }
   any& operator=(const msgpack::object& o) {
-    zone_.clear();
-    copy_msgpack_object(o, &object_, zone_);
-    type = static_cast<linear::type::any::Type>(object_.type);
+    assign(o);
     return *this;
   }
   bool operator<(const any& a) const {
@@ -106,10 +106,15 @@ class any {
   /**
    * get internal msgpack::zone reference.
    * @warning return value is for referencing only.
+   * the zone is shared by all copies of this object.
    * @return msgpack::zone
    */
   const msgpack::zone& zone() const {
-    return zone_;
+    if (!zone_) {
+      static const msgpack::zone empty;
+      return empty;
+    }
+    return *zone_;
   }
   /// @endcond
 
@@ -158,9 +163,7 @@ class any {
     pk.pack(object_);
   }
   void msgpack_unpack(msgpack::object o) {
-    zone_.clear();
-    copy_msgpack_object(o, &object_, zone_);
-    type = static_cast<linear::type::any::Type>(object_.type);
+    assign(o);
   }
   template <typename MSGPACK_OBJECT>
   void msgpack_object(MSGPACK_OBJECT* o, msgpack::zone& z) const {
@@ -173,6 +176,21 @@ class any {
     return !isprint(c);
   }
 
+  // deep copy o into a zone owned by this object.
+  // copies of any share zone_, so a new zone is created instead of clearing the current one.
+  void assign(const msgpack::object& o) {
+    linear::shared_ptr<msgpack::zone> z;
+    if (o.type == msgpack::type::STR || o.type == msgpack::type::BIN || o.type == msgpack::type::EXT ||
+        o.type == msgpack::type::ARRAY || o.type == msgpack::type::MAP) {
+      z = linear::shared_ptr<msgpack::zone>(new msgpack::zone());
+      copy_msgpack_object(o, &object_, *z);
+    } else {
+      object_ = o;
+    }
+    zone_ = z;
+    type = static_cast<linear::type::any::Type>(object_.type);
+  }
+
   void copy_msgpack_object(const msgpack::object& src, msgpack::object* dst, msgpack::zone& z) const {
     dst->type = src.type;
     switch (src.type) {
@@ -266,8 +284,8 @@ class any {
     }
   }
 
-  msgpack::zone   zone_;
-  msgpack::object object_;
+  linear::shared_ptr<msgpack::zone> zone_;
+  msgpack::object                   object_;
 
 public:
   /**
@@ -371,11 +389,11 @@ inline std::ostream& operator<< (std::ostream& s, const linear::type::any& a) {
     s << "[";
     if(o.via.array.size != 0) {
       msgpack::object* p(o.via.array.ptr);
-      s << linear::type::any(*p);
+      s << linear::type::any(*p, linear::shared_ptr<msgpack::zone>());
       ++p;
       for(msgpack::object* const pend(o.via.array.ptr + o.via.array.size);
           p < pend; ++p) {
-        s << ", " << linear::type::any(*p);
+        s << ", " << linear::type::any(*p, linear::shared_ptr<msgpack::zone>());
       }
     }
     s << "]";
@@ -385,11 +403,13 @@ inline std::ostream& operator<< (std::ostream& s, const linear::type::any& a) {
     s << "{";
     if(o.via.map.size != 0) {
       msgpack::object_kv* p(o.via.map.ptr);
-      s << linear::type::any(p->key) << ':' << linear::type::any(p->val);
+      s << linear::type::any(p->key, linear::shared_ptr<msgpack::zone>()) << ':'
+        << linear::type::any(p->val, linear::shared_ptr<msgpack::zone>());
       ++p;
       for(msgpack::object_kv* const pend(o.via.map.ptr + o.via.map.size);
           p < pend; ++p) {
-        s << ", " << linear::type::any(p->key) << ':' << linear::type::any(p->val);
+        s << ", " << linear::type::any(p->key, linear::shared_ptr<msgpack::zone>()) << ':'
+          << linear::type::any(p->val, linear::shared_ptr<msgpack::zone>());
       }
     }
     s << "}";
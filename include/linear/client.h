@@ -6,6 +6,8 @@
 #ifndef LINEAR_CLIENT_H_
 #define LINEAR_CLIENT_H_
 
+#include "linear/dispatcher.h"
+#include "linear/error.h"
 #include "linear/event_loop.h"
 
 namespace linear {
@@ -23,6 +25,16 @@ class LINEAR_EXTERN Client {
   virtual ~Client() {}
   /// @endcond
 
+  /**
+   * Calls Handler callbacks of the client in worker threads of a dispatcher.
+   * callbacks of a socket are called in order, and callbacks of different sockets
+   * are called concurrently, so that the Handler must be thread safe.
+   * @param [in] dispatcher linear::Dispatcher object
+   * @return linear::Error object
+   * @note call before sockets connect.
+   */
+  virtual linear::Error SetDispatcher(const linear::Dispatcher& dispatcher) const;
+
  protected:
   /// @cond hidden
   linear::shared_ptr<linear::ClientImpl> client_;
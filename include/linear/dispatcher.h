@@ -0,0 +1,55 @@
+/**
+ * @file dispatcher.h
+ * Dispatcher class definition
+ */
+
+#ifndef LINEAR_DISPATCHER_H_
+#define LINEAR_DISPATCHER_H_
+
+#include <stddef.h>
+
+#include "linear/memory.h"
+#include "linear/private/extern.h"
+
+namespace linear {
+
+class DispatcherImpl;
+
+/**
+ * @class Dispatcher dispatcher.h "linear/dispatcher.h"
+ * Dispatcher class.
+ * enable to call Handler callbacks in a pool of worker threads instead of the event loop thread,
+ * so that slow handlers do not stall the other sockets of the loop.
+ * callbacks of a socket are called one by one in the order of events,
+ * and callbacks of different sockets are called concurrently.
+ * @see linear::Server::SetDispatcher, linear::Client::SetDispatcher
+ *
+ @code
+ linear::Dispatcher dispatcher(8);
+ linear::TCPServer server(handler);
+ server.SetDispatcher(dispatcher);
+ server.Start("0.0.0.0", 37800);
+ @endcode
+ */
+class LINEAR_EXTERN Dispatcher {
+ public:
+  static const size_t DEFAULT_NUM_THREADS = 4;
+
+ public:
+  /**
+   * create a dispatcher and start worker threads.
+   * @param [in] num_threads number of worker threads
+   */
+  explicit Dispatcher(size_t num_threads = DEFAULT_NUM_THREADS);
+  /// @cond hidden
+  ~Dispatcher();
+  const linear::shared_ptr<linear::DispatcherImpl> GetImpl() const;
+  /// @endcond
+
+ private:
+  linear::shared_ptr<linear::DispatcherImpl> dispatcher_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_DISPATCHER_H_
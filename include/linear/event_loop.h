@@ -7,6 +7,7 @@
 #define LINEAR_EVENT_LOOP_H_
 
 #include "linear/memory.h"
+#include "linear/metrics.h"
 #include "linear/private/extern.h"
 
 namespace linear {
@@ -24,6 +25,15 @@ class LINEAR_EXTERN EventLoop {
   static const EventLoop& GetDefault();
 
  public:
+  /**
+   * get metrics of the event loop.
+   * lag is measured when timeouts (request timeouts etc.) fire, and a probe timeout
+   * started by the first call fires every second, so that lag follows an idle loop too.
+   * @return linear::EventLoopMetrics
+   * @see linear::metrics::EnableDump
+   */
+  linear::EventLoopMetrics GetMetrics() const;
+
   /// @cond hidden
   EventLoop();
   ~EventLoop();
@@ -36,6 +36,13 @@ class LINEAR_EXTERN Group {
    * @return socket set
    */
   static std::set<linear::Socket> Get(const std::string& name);
+  /**
+   * get linear::Socket that belongs to the specific group without copying them.
+   * @param name group name
+   * @return read-only snapshot of the socket set.
+   * later Join / Leave do not change the snapshot.
+   */
+  static linear::shared_ptr<const std::set<linear::Socket> > Members(const std::string& name);
   /**
    * joins the specific linear::Socket to the specific group.
    * @param name group name
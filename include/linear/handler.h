@@ -138,6 +138,18 @@ class LINEAR_EXTERN Handler {
    @endcode
    */
   virtual void OnError(const linear::Socket&, const linear::Message&, const linear::Error&) {}
+  /**
+   * called when the send queue drops to the low watermark after Send returned LNR_EAGAIN
+   * @param socket writable socket
+   * @see linear::Socket::SetSendWatermark
+   *
+   @code
+   void YourHandler::OnWritable(const linear::Socket& socket) {
+     resume_sending(socket);
+   }
+   @endcode
+   */
+  virtual void OnWritable(const linear::Socket&) {}
 };
 
 }  // namespace linear
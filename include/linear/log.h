@@ -6,6 +6,9 @@
 #ifndef LINEAR_LOG_H_
 #define LINEAR_LOG_H_
 
+#include <stdint.h>
+#include <string.h>
+
 #include <string>
 
 #include "linear/private/extern.h"
@@ -31,8 +34,18 @@
 # define LINEAR_DEBUG(level, format, ...)
 #endif
 
+// stringify for text logs (not truncated on LOG_FULL).
+// when only the binary log is enabled, pack the msgpack bytes into a blob instead,
+// and tools/linear_logdecode renders it.
 #define LINEAR_LOG_PRINTABLE_STRING(any) \
-  ((linear::log::GetLevel() == linear::log::LOG_FULL) ? any.stringify() : any.stringify(64))
+  (linear::log::DoFormat() ? \
+   ((linear::log::GetLevel() == linear::log::LOG_FULL) ? any.stringify() : any.stringify(64)) : \
+   linear::log::PackBlob<msgpack::packer<linear::log::BlobBuffer> >(any))
+
+// a blob is a string passed to "%s", that is made of the marker,
+// uint32_t size of the bytes (native byte order) and the bytes.
+#define LINEAR_LOG_BLOB_MARKER "\x1bLNRBLOB"
+#define LINEAR_LOG_BLOB_MARKER_SIZE (sizeof(LINEAR_LOG_BLOB_MARKER) - 1)
 /// @endcond
 
 namespace linear {
@@ -88,6 +101,19 @@ enum Level {
 #undef LINEAR_LOG_LEVEL_GEN
 /** @endcond **/
 
+/**
+ * @enum linear::log::OverflowPolicy
+ * behavior when the queue of linear::log::EnableAsync is full
+ * @var LOG_OVERFLOW_DROP
+ * drop the log and count it (see linear::log::GetDroppedCount)
+ * @var LOG_OVERFLOW_BLOCK
+ * wait until the writer thread makes room
+ **/
+enum OverflowPolicy {
+  LOG_OVERFLOW_DROP,
+  LOG_OVERFLOW_BLOCK
+};
+
 /**
  * typeof callback function for linear::log
  * @param level [out] log level
@@ -126,6 +152,36 @@ LINEAR_EXTERN bool EnableStderr();
  **/
 LINEAR_EXTERN bool EnableFile(const std::string& filename);
 
+/**
+ * write log to specified file, and rotate it by size or interval
+ *
+ * when the file exceeds max_size or interval passes, it is renamed to "<filename>.1"
+ * (older ones to "<filename>.2", ...), and logs are written to a new file.
+ * the new file is opened in advance by a background thread,
+ * so that rotation does not block threads writing logs.
+ * logs are appended to the file if it already exists.
+ * rotation is supported only on POSIX systems, because the next file is renamed
+ * while it is written, and windows does not allow it.
+ * @param filename [in] file name to write logs
+ * @param max_size [in] max size of a file in bytes (0: no limit)
+ * @param interval [in] max lifetime of a file in seconds (0: no limit)
+ * @param retention [in] number of rotated files to keep
+ * @return false on windows, unless both max_size and interval are 0
+ * @note call DisableFile() at the end of your application
+ **/
+LINEAR_EXTERN bool EnableFile(const std::string& filename, size_t max_size,
+                              unsigned int interval = 0, size_t retention = 5);
+
+/**
+ * write logs to specified file in binary format
+ *
+ * records keep the raw arguments of each log instead of formatted text,
+ * and are rendered later by tools/linear_logdecode.
+ * @param filename [in] file name to write logs
+ * @note call DisableBinaryFile() at the end of your application
+ **/
+LINEAR_EXTERN bool EnableBinaryFile(const std::string& filename);
+
 /**
  * start to callback for writing logs
  * @param function [in] function name to output logs
@@ -133,6 +189,19 @@ LINEAR_EXTERN bool EnableFile(const std::string& filename);
  **/
 LINEAR_EXTERN bool EnableCallback(linear::log::LogCallback function);
 
+/**
+ * write logs to stderr and file in a background thread
+ *
+ * logs are queued and written in batches, so that formatting and flushing them
+ * do not block the event loop threads.
+ * logs to the callback are still written synchronously.
+ * @param capacity [in] max number of queued logs
+ * @param policy [in] linear::log::OverflowPolicy when capacity is exceeded
+ * @note call DisableAsync() at the end of your application to write remaining logs
+ **/
+LINEAR_EXTERN bool EnableAsync(size_t capacity = 8192,
+                               linear::log::OverflowPolicy policy = linear::log::LOG_OVERFLOW_DROP);
+
 /**
  * hide logs from stderr
  **/
@@ -143,11 +212,27 @@ LINEAR_EXTERN void DisableStderr();
  **/
 LINEAR_EXTERN void DisableFile();
 
+/**
+ * stop to write binary logs and close file
+ **/
+LINEAR_EXTERN void DisableBinaryFile();
+
 /**
  * stop to callback for writing logs
  **/
 LINEAR_EXTERN void DisableCallback();
 
+/**
+ * write queued logs, stop the background thread and write logs synchronously again
+ **/
+LINEAR_EXTERN void DisableAsync();
+
+/**
+ * get number of logs dropped by LOG_OVERFLOW_DROP
+ * @return number of dropped logs
+ **/
+LINEAR_EXTERN size_t GetDroppedCount();
+
 /**
  * colorize logs
  * effects only LogStderr
@@ -156,7 +241,36 @@ LINEAR_EXTERN void DisableCallback();
 LINEAR_EXTERN void Colorize(bool flag = true);
 
 /// @cond hidden
+// msgpack buffer that packs an object into a blob
+class BlobBuffer {
+ public:
+  BlobBuffer() : blob_(LINEAR_LOG_BLOB_MARKER) {
+    blob_.append(sizeof(uint32_t), '\0');
+  }
+  void write(const char* data, size_t size) {
+    blob_.append(data, size);
+  }
+  const std::string& blob() {
+    uint32_t size = static_cast<uint32_t>(blob_.size() - LINEAR_LOG_BLOB_MARKER_SIZE - sizeof(uint32_t));
+    memcpy(&blob_[LINEAR_LOG_BLOB_MARKER_SIZE], &size, sizeof(size));
+    return blob_;
+  }
+
+ private:
+  std::string blob_;
+};
+
+// Packer is given by the caller, so that this header does not include msgpack
+template <typename Packer, typename Value>
+std::string PackBlob(const Value& value) {
+  BlobBuffer buffer;
+  Packer packer(buffer);
+  value.msgpack_pack(packer);
+  return buffer.blob();
+}
+
 LINEAR_EXTERN bool DoPrint(linear::log::Level level);
+LINEAR_EXTERN bool DoFormat();
 #ifdef _WIN32
 LINEAR_EXTERN void Print(bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* format, ...);
 #else
@@ -0,0 +1,93 @@
+/**
+ * @file metrics.h
+ * Metrics of sockets and event loops
+ */
+
+#ifndef LINEAR_METRICS_H_
+#define LINEAR_METRICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "linear/error.h"
+#include "linear/private/extern.h"
+
+namespace linear {
+
+/**
+ * @class SocketMetrics metrics.h "linear/metrics.h"
+ * Counters of a socket
+ * @see linear::Socket::GetMetrics
+ */
+struct LINEAR_EXTERN SocketMetrics {
+  /// @cond hidden
+  SocketMetrics()
+    : sent_requests(0), sent_responses(0), sent_notifies(0), sent_bytes(0),
+      recv_requests(0), recv_responses(0), recv_notifies(0), recv_bytes(0),
+      send_queue_size(0), pending_requests(0), request_timeouts(0), decode_errors(0),
+      connect_time(0),
+      sent_compressed(0), sent_compressed_bytes(0), sent_uncompressed_bytes(0), compress_time(0),
+      recv_compressed(0), recv_compressed_bytes(0), recv_uncompressed_bytes(0), decompress_time(0) {}
+  /// @endcond
+
+  uint64_t sent_requests;   //!< number of requests passed to the stream
+  uint64_t sent_responses;  //!< number of responses passed to the stream
+  uint64_t sent_notifies;   //!< number of notifies passed to the stream
+  uint64_t sent_bytes;      //!< bytes of messages passed to the stream (without WebSocket frame header)
+  uint64_t recv_requests;   //!< number of received requests
+  uint64_t recv_responses;  //!< number of received responses
+  uint64_t recv_notifies;   //!< number of received notifies
+  uint64_t recv_bytes;      //!< bytes read from the stream
+  size_t send_queue_size;   //!< bytes passed to the stream and not written yet
+  size_t pending_requests;  //!< number of requests waiting for their responses
+  uint64_t request_timeouts; //!< number of requests timed out
+  uint64_t decode_errors;   //!< number of invalid, malformed or too big messages received
+  uint64_t connect_time;    //!< usec from Connect (or accept) to OnConnect, including handshake
+  // per-message compression (see linear::Socket::SetCompression).
+  // compression ratio is sent_uncompressed_bytes / sent_compressed_bytes, and the same for recv_*.
+  uint64_t sent_compressed;         //!< number of messages sent compressed
+  uint64_t sent_compressed_bytes;   //!< bytes of messages sent compressed, after compression
+  uint64_t sent_uncompressed_bytes; //!< bytes of messages sent compressed, before compression
+  uint64_t compress_time;           //!< usec spent to compress, including messages that did not get smaller
+  uint64_t recv_compressed;         //!< number of received compressed messages
+  uint64_t recv_compressed_bytes;   //!< bytes of received compressed messages
+  uint64_t recv_uncompressed_bytes; //!< bytes of received compressed messages, after decompression
+  uint64_t decompress_time;         //!< usec spent to decompress
+};
+
+/**
+ * @class EventLoopMetrics metrics.h "linear/metrics.h"
+ * Counters of an event loop
+ * @see linear::EventLoop::GetMetrics
+ */
+struct LINEAR_EXTERN EventLoopMetrics {
+  /// @cond hidden
+  EventLoopMetrics() : lag(0), max_lag(0), timeouts(0) {}
+  /// @endcond
+
+  uint64_t lag;     //!< msec the last timeout fired after its deadline, or the earliest one is overdue now
+  uint64_t max_lag; //!< max of lag
+  size_t timeouts;  //!< number of timeouts waiting in the loop (requests, connects and others)
+};
+
+namespace metrics {
+
+/**
+ * dump total metrics of all sockets and metrics of default event loop periodically.
+ * metrics are output by LINEAR_LOG with LOG_INFO, so that enabled log outputs
+ * (including linear::log::EnableCallback) receive them.
+ * lag of default event loop is sampled every second once metrics are read.
+ * @param [in] interval dump interval (msec)
+ * @return linear::Error object
+ */
+LINEAR_EXTERN linear::Error EnableDump(unsigned int interval);
+/**
+ * stop dumping metrics.
+ */
+LINEAR_EXTERN void DisableDump();
+
+}  // namespace metrics
+
+}  // namespace linear
+
+#endif  // LINEAR_METRICS_H_
@@ -0,0 +1,116 @@
+/**
+ * @file router_priv.h
+ * Implementations of Router class templates
+ */
+
+#ifndef LINEAR_PRIVATE_ROUTER_PRIV_H_
+#define LINEAR_PRIVATE_ROUTER_PRIV_H_
+
+namespace linear {
+
+/// @cond hidden
+// value type to decode params into, for arguments taken by reference
+template <typename T>
+struct RouterParams {
+  typedef T type;
+};
+template <typename T>
+struct RouterParams<const T> {
+  typedef T type;
+};
+template <typename T>
+struct RouterParams<T&> {
+  typedef T type;
+};
+template <typename T>
+struct RouterParams<const T&> {
+  typedef T type;
+};
+/// @endcond
+
+template <typename Callback>
+class Router::Route : public Router::IRoute {
+ public:
+  Route(Callback callback) : callback_(callback) {}
+  virtual ~Route() {}
+
+  void Fire(const linear::Socket& socket, const linear::Message& message) const {
+    callback_(socket, message);
+  }
+
+ private:
+  Callback callback_;
+};
+
+template <typename Result, typename Params>
+class Router::RequestRoute : public Router::IRoute {
+ public:
+  typedef Result (*Function)(const linear::Socket&, Params);
+
+  RequestRoute(Function func) : func_(func) {}
+  virtual ~RequestRoute() {}
+
+  void Fire(const linear::Socket& socket, const linear::Message& message) const {
+    if (message.type != linear::REQUEST) {
+      return;
+    }
+    const linear::Request& request = static_cast<const linear::Request&>(message);
+    typename RouterParams<Params>::type params;
+    try {
+      // convert from the decoded object without copying it into linear::type::any
+      request.params.object().convert(params);
+    } catch(...) {
+      linear::Response(request.msgid, linear::type::nil(), std::string("invalid params")).Send(socket);
+      return;
+    }
+    linear::Response(request.msgid, func_(socket, params)).Send(socket);
+  }
+
+ private:
+  Function func_;
+};
+
+template <typename Params>
+class Router::NotifyRoute : public Router::IRoute {
+ public:
+  typedef void (*Function)(const linear::Socket&, Params);
+
+  NotifyRoute(Function func) : func_(func) {}
+  virtual ~NotifyRoute() {}
+
+  void Fire(const linear::Socket& socket, const linear::Message& message) const {
+    if (message.type != linear::NOTIFY) {
+      return;
+    }
+    const linear::Notify& notify = static_cast<const linear::Notify&>(message);
+    typename RouterParams<Params>::type params;
+    try {
+      notify.params.object().convert(params);
+    } catch(...) {
+      return;
+    }
+    func_(socket, params);
+  }
+
+ private:
+  Function func_;
+};
+
+template <typename Callback>
+void Router::Add(const std::string& method, Callback callback) {
+  _Add(method, linear::shared_ptr<IRoute>(new Route<Callback>(callback)));
+}
+
+template <typename Result, typename Params>
+void Router::AddRequest(const std::string& method, Result (*func)(const linear::Socket&, Params)) {
+  _Add(method, linear::shared_ptr<IRoute>(new RequestRoute<Result, Params>(func)));
+}
+
+template <typename Params>
+void Router::AddNotify(const std::string& method, void (*func)(const linear::Socket&, Params)) {
+  _Add(method, linear::shared_ptr<IRoute>(new NotifyRoute<Params>(func)));
+}
+
+}  // namespace linear
+
+#endif  // LINEAR_PRIVATE_ROUTER_PRIV_H_
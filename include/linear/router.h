@@ -0,0 +1,122 @@
+/**
+ * @file router.h
+ * Router class definition
+ */
+
+#ifndef LINEAR_ROUTER_H_
+#define LINEAR_ROUTER_H_
+
+#include "linear/handler.h"
+
+namespace linear {
+
+class RouterImpl;
+
+/**
+ * @class Router router.h "linear/router.h"
+ * Handler that routes requests and notifies to callbacks registered per method.
+ * callbacks are looked up from a hash table by the method name,
+ * and params are decoded straight into the argument type of the callback.
+ * override other callbacks of linear::Handler (OnConnect etc.) as usual,
+ * but do not override OnMessage.
+ * @note register all methods before starting servers or connecting sockets,
+ * because the table is not locked while routing.
+ *
+ @code
+ static int Add(const linear::Socket&, const std::vector<int>& params) {
+   return params[0] + params[1];
+ }
+ static void Log(const linear::Socket&, const std::string& params) {
+   std::cout << params << std::endl;
+ }
+ static void Echo(const linear::Socket& socket, const linear::Message& message) {
+   const linear::Request& request = message.as<linear::Request>();
+   linear::Response(request.msgid, request.params).Send(socket);
+ }
+
+ linear::shared_ptr<linear::Router> router(new linear::Router());
+ router->AddRequest("add", Add);   // Response(msgid, Add(socket, params)) is sent
+ router->AddNotify("log", Log);
+ router->Add("echo", Echo);        // called with the raw message
+ linear::TCPServer server(router);
+ @endcode
+ */
+class LINEAR_EXTERN Router : public linear::Handler {
+ public:
+  /// @cond hidden
+  class IRoute {
+   public:
+    virtual ~IRoute() {}
+    virtual void Fire(const linear::Socket& socket, const linear::Message& message) const = 0;
+  };
+  /// @endcond
+
+ public:
+  Router();
+  virtual ~Router();
+
+  /**
+   * register a callback called with the raw message of the method.
+   * @param [in] method method name of requests and notifies
+   * @param [in] callback function or functor called as callback(const linear::Socket&, const linear::Message&)
+   */
+  template <typename Callback>
+  void Add(const std::string& method, Callback callback);
+  /**
+   * register a callback of requests.
+   * params are decoded into Params, and a response with the returned value is sent.
+   * if params can not be decoded, a response with error "invalid params" is sent.
+   * @param [in] method method name of requests
+   * @param [in] func function as Result func(const linear::Socket&, Params)
+   */
+  template <typename Result, typename Params>
+  void AddRequest(const std::string& method, Result (*func)(const linear::Socket&, Params));
+  /**
+   * register a callback of notifies.
+   * params are decoded into Params, and notifies with invalid params are ignored.
+   * @param [in] method method name of notifies
+   * @param [in] func function as void func(const linear::Socket&, Params)
+   */
+  template <typename Params>
+  void AddNotify(const std::string& method, void (*func)(const linear::Socket&, Params));
+  /**
+   * unregister callbacks of the method.
+   * @param [in] method method name
+   */
+  void Remove(const std::string& method);
+
+  /**
+   * called when a response is received and the request has no closure
+   * @param socket socket that received the response
+   * @param response received response
+   */
+  virtual void OnResponse(const linear::Socket& socket, const linear::Response& response);
+  /**
+   * called when a request or a notify of unregistered method is received.
+   * sends a response with error "method not found" to requests by default.
+   * @param socket socket that received the message
+   * @param message received request or notify
+   */
+  virtual void OnUnknownMethod(const linear::Socket& socket, const linear::Message& message);
+
+  /// @cond hidden
+  void OnMessage(const linear::Socket& socket, const linear::Message& message);
+  /// @endcond
+
+ private:
+  template <typename Callback>
+  class Route;
+  template <typename Result, typename Params>
+  class RequestRoute;
+  template <typename Params>
+  class NotifyRoute;
+
+  void _Add(const std::string& method, const linear::shared_ptr<IRoute>& route);
+
+  linear::shared_ptr<linear::RouterImpl> router_;
+};
+
+}  // namespace linear
+
+#include "linear/private/router_priv.h"
+#endif  // LINEAR_ROUTER_H_
@@ -6,8 +6,12 @@
 #ifndef LINEAR_SERVER_H_
 #define LINEAR_SERVER_H_
 
+#include <vector>
+
+#include "linear/dispatcher.h"
 #include "linear/error.h"
 #include "linear/event_loop.h"
+#include "linear/socket.h"
 
 namespace linear {
 
@@ -31,6 +35,23 @@ class LINEAR_EXTERN Server {
    * @return linear::Error object
    */
   virtual linear::Error SetMaxClients(size_t max_clients) const;
+  /**
+   * Gets sockets that are connected to a server.
+   * @return snapshot of connected sockets
+   * @note sockets may be disconnected after return, so use them as usual
+   * (e.g. Send returns an error for a disconnected socket).
+   * useful to drain or broadcast to all clients.
+   */
+  virtual std::vector<linear::Socket> GetSockets() const;
+  /**
+   * Calls Handler callbacks of the server in worker threads of a dispatcher.
+   * callbacks of a socket are called in order, and callbacks of different sockets
+   * are called concurrently, so that the Handler must be thread safe.
+   * @param [in] dispatcher linear::Dispatcher object
+   * @return linear::Error object
+   * @note call before Start.
+   */
+  virtual linear::Error SetDispatcher(const linear::Dispatcher& dispatcher) const;
   /**
    * Starts a server with specified parameters.
    * @param [in] hostname IPAddr or FQDN of host
@@ -9,6 +9,7 @@
 #include "linear/addrinfo.h"
 #include "linear/error.h"
 #include "linear/memory.h"
+#include "linear/metrics.h"
 
 namespace linear {
 
@@ -23,6 +24,8 @@ class LINEAR_EXTERN Socket {
  public:
   //! default max message buffer size (8MB)
   static const size_t DEFAULT_MAX_BUFFER_SIZE = 8 * 1024 * 1024;
+  //! default send batch size (64KB)
+  static const size_t DEFAULT_SEND_BATCH_SIZE = 64 * 1024;
 
   //! socket type indicator
   enum Type {
@@ -92,6 +95,55 @@ class LINEAR_EXTERN Socket {
    * @see linear::Socket::DEFAULT_MAX_BUFFER_SIZE
    */
   virtual linear::Error SetMaxRecvBufferSize(size_t limit) const;
+  /**
+   * set send batch size.
+   * messages sent while a previous write is in progress are packed into one buffer
+   * and written at once when that write completes or the buffer exceeds limit.
+   * OnError is still called for each message that fails to be sent.
+   * @param [in] limit max size of a batch (byte), 0 disables batching
+   * @return linear::Error object
+   * @see linear::Socket::DEFAULT_SEND_BATCH_SIZE
+   */
+  virtual linear::Error SetSendBatchSize(size_t limit) const;
+  /**
+   * use msgid space of this socket.
+   * requests sent to this socket get msgid from a counter of the socket instead of
+   * the process wide counter, so that msgid does not wrap around early in a process
+   * that sends many requests through many sockets.
+   * msgid of the linear::Request given to Send is not changed, so refer
+   * linear::Response::request to know msgid that is actually sent.
+   * @param [in] enable true to use msgid space of this socket (false as default)
+   * @return linear::Error object
+   */
+  virtual linear::Error SetPerSocketMsgid(bool enable) const;
+  /**
+   * send methods of requests and notifies as integer ids instead of strings.
+   * the socket sends a notify with method "$linear.intern" before the first message,
+   * and methods are sent as ids after the same notify is received from the peer,
+   * so that peers which do not enable this (or other msgpack-rpc implementations)
+   * keep receiving methods as strings.
+   * the id of a method is defined in the first message of the method, and is valid until disconnected.
+   * handlers receive methods as strings in any case.
+   * @param [in] enable true to enable method interning (false as default)
+   * @return linear::Error object
+   * @note call before Connect, or enable on both of client and server sockets.
+   */
+  virtual linear::Error SetMethodInterning(bool enable) const;
+  /**
+   * compress messages whose packed size is threshold bytes or more.
+   * the socket sends a notify with method "$linear.compress" before the first message,
+   * and messages are compressed after the same notify is received from the peer,
+   * in the same way as SetMethodInterning.
+   * a message is sent as is when it does not get smaller, and compressed messages
+   * are decompressed before handlers receive them.
+   * received messages are limited to the max recv buffer size after decompressed.
+   * @param [in] threshold min size of messages to compress (0 as default, that disables compression)
+   * @return linear::Error object
+   * @retval linear::LNR_ENOTSUP linear is built without zlib (configure --with-zlib)
+   * @note call before Connect, or enable on both of client and server sockets.
+   * @see linear::SocketMetrics::sent_compressed
+   */
+  virtual linear::Error SetCompression(size_t threshold) const;
   /**
    * connect to target.
    * @param [in] timeout connect timeout(msec)\n
@@ -161,6 +213,30 @@ class LINEAR_EXTERN Socket {
    * @return linear::Addrinfo
    */
   virtual const linear::Addrinfo& GetPeerInfo() const;
+  /**
+   * get number of requests that are sent and waiting for their responses.
+   * @return number of requests in flight
+   */
+  virtual size_t GetInFlightRequestCount() const;
+  /**
+   * get metrics of the socket.
+   * @return linear::SocketMetrics
+   */
+  virtual linear::SocketMetrics GetMetrics() const;
+  /**
+   * get size of send queue.
+   * @return bytes passed to the stream and not written yet
+   */
+  virtual size_t GetSendQueueSize() const;
+  /**
+   * set watermarks of send queue.
+   * while the send queue is high bytes or more, Send returns LNR_EAGAIN without sending,
+   * and linear::Handler::OnWritable is called once the queue drops to low bytes or less.
+   * @param [in] high high watermark (byte), 0 disables watermarks (as default)
+   * @param [in] low low watermark (byte)
+   * @return linear::Error object, LNR_EINVAL when low is more than high
+   */
+  virtual linear::Error SetSendWatermark(size_t high, size_t low) const;
 
   // @cond hidden
   virtual linear::Error Send(const linear::Message& message, int timeout = 30000) const;
@@ -61,18 +61,28 @@
         'src/addrinfo.cpp',
         'src/auth_context.cpp',
         'src/auth_context_impl.cpp',
+        'src/client.cpp',
+        'src/compression.cpp',
         'src/condition_variable.cpp',
+        'src/deadline_queue.cpp',
+        'src/dispatcher_impl.cpp',
         'src/error.cpp',
         'src/event_loop.cpp',
         'src/event_loop_impl.cpp',
         'src/group.cpp',
         'src/handler_delegate.cpp',
         'src/log.cpp',
+        'src/log_async.cpp',
+        'src/log_binary.cpp',
         'src/log_file.cpp',
         'src/log_function.cpp',
+        'src/log_rotator.cpp',
         'src/log_stderr.cpp',
         'src/message.cpp',
+        'src/metrics.cpp',
         'src/mutex.cpp',
+        'src/resolver.cpp',
+        'src/router.cpp',
         'src/server.cpp',
         'src/socket.cpp',
         'src/socket_impl.cpp',
@@ -128,6 +138,14 @@
             'src/x509_certificate.cpp',
           ],
         }],
+        [ 'with_zlib != "false"', {
+          'defines': [
+            'WITH_ZLIB',
+          ],
+          'link_settings': {
+            'libraries': [ '-lz' ],
+          },
+        }],
         ['OS=="win"', {
           'defines': [
             # https://msdn.microsoft.com/en-US/library/windows/desktop/aa383745(v=vs.85).aspx
@@ -0,0 +1,692 @@
+// linear benchmark suite
+//
+// run a server and clients in one process over loopback,
+// and report throughput and latency percentiles measured by a monotonic clock.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "linear/condition_variable.h"
+#include "linear/group.h"
+#include "linear/log.h"
+#include "linear/tcp_client.h"
+#include "linear/tcp_server.h"
+#include "linear/ws_client.h"
+#include "linear/ws_server.h"
+
+#ifdef WITH_SSL
+# include "linear/ssl_client.h"
+# include "linear/ssl_server.h"
+# include "linear/wss_client.h"
+# include "linear/wss_server.h"
+#endif
+
+#define DEFAULT_NUM     (10000)
+#define DEFAULT_MSIZ    (128)
+#define DEFAULT_DEPTH   (1)
+#define DEFAULT_CLIENTS (1)
+
+#define SERVER_CERT        "./certs/server.pem"
+#define SERVER_PRIVATE_KEY "./certs/server.key"
+
+#define BENCH_GROUP "lbench"
+
+using namespace linear::log;
+
+typedef enum {
+  TRANSPORT_TCP,
+  TRANSPORT_SSL,
+  TRANSPORT_WS,
+  TRANSPORT_WSS,
+} Transport;
+
+typedef enum {
+  PATTERN_REQUEST,   // request and echo response
+  PATTERN_NOTIFY,    // notify streaming from clients to server
+  PATTERN_BROADCAST, // notify to a group from server to all clients
+} Pattern;
+
+typedef enum {
+  FORMAT_TEXT,
+  FORMAT_JSON,
+  FORMAT_CSV,
+} Format;
+
+struct Config {
+  Transport transport;
+  Pattern pattern;
+  Format format;
+  size_t msiz;
+  size_t depth;   // number of messages in flight for each socket
+  size_t clients; // number of client sockets
+  size_t num;     // number of messages for each socket, or number of broadcasts
+  std::string host;
+  int port;
+};
+
+static const char* TransportString(Transport transport) {
+  switch(transport) {
+  case TRANSPORT_TCP:
+    return "tcp";
+  case TRANSPORT_SSL:
+    return "ssl";
+  case TRANSPORT_WS:
+    return "ws";
+  case TRANSPORT_WSS:
+    return "wss";
+  default:
+    return "unknown";
+  }
+}
+
+static const char* PatternString(Pattern pattern) {
+  switch(pattern) {
+  case PATTERN_REQUEST:
+    return "request";
+  case PATTERN_NOTIFY:
+    return "notify";
+  case PATTERN_BROADCAST:
+    return "broadcast";
+  default:
+    return "unknown";
+  }
+}
+
+// monotonic clock (nsec)
+static uint64_t Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+struct Payload {
+  Payload() : sent(0) {}
+  Payload(uint64_t s, const std::string& d) : sent(s), data(d) {}
+  ~Payload() {}
+
+  uint64_t sent; // monotonic clock (nsec) when sent
+  std::string data;
+
+  LINEAR_PACK(sent, data);
+};
+
+// all of sockets share one process, so latency is (received - sent) of the same clock
+class Stats {
+ public:
+  Stats() : start_(0), end_(0), errors_(0) {}
+  ~Stats() {}
+
+  void Start() {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    start_ = end_ = Now();
+  }
+  void Record(uint64_t sent) {
+    uint64_t now = Now();
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    latencies_.push_back(now - sent);
+    end_ = now;
+  }
+  void RecordError() {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    errors_++;
+  }
+  void Report(const Config& config) {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    std::sort(latencies_.begin(), latencies_.end());
+    double elapsed = (end_ - start_) / 1000000000.0;
+    double throughput = (elapsed > 0) ? latencies_.size() / elapsed : 0;
+    double mbps = throughput * config.msiz / 1000000.0;
+
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    switch(config.format) {
+    case FORMAT_JSON:
+      os << "{\"transport\":\"" << TransportString(config.transport) << "\""
+         << ",\"pattern\":\"" << PatternString(config.pattern) << "\""
+         << ",\"size\":" << config.msiz
+         << ",\"depth\":" << config.depth
+         << ",\"clients\":" << config.clients
+         << ",\"messages\":" << latencies_.size()
+         << ",\"errors\":" << errors_
+         << ",\"elapsed_sec\":" << elapsed
+         << ",\"throughput_msgs\":" << throughput
+         << ",\"throughput_mbytes\":" << mbps
+         << ",\"latency_usec\":{"
+         << "\"min\":" << _Percentile(0)
+         << ",\"p50\":" << _Percentile(500)
+         << ",\"p99\":" << _Percentile(990)
+         << ",\"p999\":" << _Percentile(999)
+         << ",\"max\":" << _Percentile(1000)
+         << "}}" << std::endl;
+      break;
+    case FORMAT_CSV:
+      os << "transport,pattern,size,depth,clients,messages,errors,elapsed_sec,"
+         << "throughput_msgs,throughput_mbytes,min_usec,p50_usec,p99_usec,p999_usec,max_usec" << std::endl
+         << TransportString(config.transport) << ","
+         << PatternString(config.pattern) << ","
+         << config.msiz << ","
+         << config.depth << ","
+         << config.clients << ","
+         << latencies_.size() << ","
+         << errors_ << ","
+         << elapsed << ","
+         << throughput << ","
+         << mbps << ","
+         << _Percentile(0) << ","
+         << _Percentile(500) << ","
+         << _Percentile(990) << ","
+         << _Percentile(999) << ","
+         << _Percentile(1000) << std::endl;
+      break;
+    case FORMAT_TEXT:
+    default:
+      os << "--- Result ---" << std::endl
+         << "success: " << latencies_.size() << ", error: " << errors_
+         << ", elapsed: " << elapsed << "sec" << std::endl
+         << "throughput => " << throughput << "msgs/sec, " << mbps << "MB/sec" << std::endl
+         << "latency => "
+         << "min: " << _Percentile(0) / 1000.0 << "ms, "
+         << "p50: " << _Percentile(500) / 1000.0 << "ms, "
+         << "p99: " << _Percentile(990) / 1000.0 << "ms, "
+         << "p99.9: " << _Percentile(999) / 1000.0 << "ms, "
+         << "max: " << _Percentile(1000) / 1000.0 << "ms" << std::endl;
+      break;
+    }
+    std::cout << os.str();
+  }
+
+ private:
+  // nearest rank percentile (usec) of sorted latencies, per_mille == 0 for min
+  double _Percentile(size_t per_mille) {
+    if (latencies_.empty()) {
+      return 0;
+    }
+    size_t rank = (latencies_.size() * per_mille + 999) / 1000;
+    return latencies_[(rank == 0) ? 0 : rank - 1] / 1000.0;
+  }
+
+  uint64_t start_, end_;
+  size_t errors_;
+  std::vector<uint64_t> latencies_; // nsec
+  linear::mutex mutex_;
+};
+
+// progress shared by the server, the clients and the main thread
+struct Bench {
+  explicit Bench(const Config& c)
+    : config(c), payload(c.msiz, 'a'), server_connected(0), client_connected(0),
+      disconnected(0), finished(0), received(0) {}
+  ~Bench() {}
+
+  const Config config;
+  const std::string payload;
+  Stats stats;
+  size_t server_connected;
+  size_t client_connected;
+  size_t disconnected; // client sockets disconnected before finish
+  size_t finished;     // client sockets that completed all messages
+  size_t received;     // broadcast messages received by all clients
+  linear::mutex mutex;
+  linear::condition_variable cv;
+};
+
+class ServerHandler : public linear::Handler {
+ public:
+  explicit ServerHandler(const linear::shared_ptr<Bench>& bench)
+    : bench_(bench), ack_every_(std::max(bench->config.depth / 2, static_cast<size_t>(1))) {}
+  ~ServerHandler() {}
+
+  void OnConnect(const linear::Socket& socket) {
+    if (bench_->config.pattern == PATTERN_BROADCAST) {
+      linear::Group::Join(BENCH_GROUP, socket);
+    }
+    linear::lock_guard<linear::mutex> lock(bench_->mutex);
+    bench_->server_connected++;
+    bench_->cv.notify_all();
+  }
+  void OnMessage(const linear::Socket& socket, const linear::Message& msg) {
+    switch(msg.type) {
+    case linear::REQUEST:
+      {
+        const linear::Request& request = msg.as<linear::Request>();
+        linear::Response response(request.msgid, request.params);
+        response.Send(socket);
+      }
+      break;
+    case linear::NOTIFY:
+      {
+        const linear::Notify& notify = msg.as<linear::Notify>();
+        bench_->stats.Record(notify.params.as<Payload>().sent);
+        size_t count;
+        {
+          linear::lock_guard<linear::mutex> lock(bench_->mutex);
+          count = ++received_[socket.GetId()];
+        }
+        // acknowledge the number of received notifies, so that the client sends next ones
+        if (count % ack_every_ == 0 || count == bench_->config.num) {
+          linear::Notify ack("ack", static_cast<uint64_t>(count));
+          ack.Send(socket);
+        }
+      }
+      break;
+    case linear::RESPONSE:
+    default:
+      break;
+    }
+  }
+
+ private:
+  linear::shared_ptr<Bench> bench_; // handlers may be called after Run returns
+  const size_t ack_every_;
+  std::map<int, size_t> received_; // key: socket id, guarded by bench_->mutex
+};
+
+class ClientHandler : public linear::Handler {
+ public:
+  explicit ClientHandler(const linear::shared_ptr<Bench>& bench) : bench_(bench) {}
+  ~ClientHandler() {}
+
+  void OnConnect(const linear::Socket& socket) {
+    linear::lock_guard<linear::mutex> lock(bench_->mutex);
+    states_[socket.GetId()] = State();
+    bench_->client_connected++;
+    bench_->cv.notify_all();
+  }
+  void OnDisconnect(const linear::Socket& socket, const linear::Error&) {
+    linear::lock_guard<linear::mutex> lock(bench_->mutex);
+    std::map<int, State>::iterator it = states_.find(socket.GetId());
+    if (it == states_.end() || it->second.done < bench_->config.num) {
+      bench_->disconnected++;
+      bench_->cv.notify_all();
+    }
+  }
+  void OnMessage(const linear::Socket& socket, const linear::Message& msg) {
+    switch(msg.type) {
+    case linear::RESPONSE:
+      {
+        const linear::Response& response = msg.as<linear::Response>();
+        if (response.error.is_nil()) {
+          bench_->stats.Record(response.result.as<Payload>().sent);
+        } else {
+          bench_->stats.RecordError();
+        }
+        Fill(socket, 1, false);
+      }
+      break;
+    case linear::NOTIFY:
+      {
+        const linear::Notify& notify = msg.as<linear::Notify>();
+        if (notify.method == "ack") {
+          Fill(socket, static_cast<size_t>(notify.params.as<uint64_t>()), true);
+        } else {
+          bench_->stats.Record(notify.params.as<Payload>().sent);
+          linear::lock_guard<linear::mutex> lock(bench_->mutex);
+          bench_->received++;
+          bench_->cv.notify_all();
+        }
+      }
+      break;
+    case linear::REQUEST:
+    default:
+      break;
+    }
+  }
+  void OnError(const linear::Socket& socket, const linear::Message& msg, const linear::Error&) {
+    bench_->stats.RecordError();
+    if (msg.type == linear::REQUEST) {
+      Fill(socket, 1, false);
+    }
+  }
+
+  // send messages until depth of messages are in flight.
+  // done is the number of completed messages, added to or replaces the current one.
+  void Fill(const linear::Socket& socket, size_t done, bool absolute) {
+    size_t n;
+    {
+      linear::lock_guard<linear::mutex> lock(bench_->mutex);
+      State& state = states_[socket.GetId()];
+      state.done = absolute ? std::max(state.done, done) : state.done + done;
+      if (state.done >= bench_->config.num) {
+        if (!state.finished) {
+          state.finished = true;
+          bench_->finished++;
+          bench_->cv.notify_all();
+        }
+        return;
+      }
+      size_t in_flight = state.sent - state.done;
+      n = std::min(bench_->config.depth - std::min(in_flight, bench_->config.depth),
+                   bench_->config.num - state.sent);
+      state.sent += n;
+    }
+    size_t failed = 0;
+    for (size_t i = 0; i < n; i++) {
+      linear::Error e;
+      if (bench_->config.pattern == PATTERN_REQUEST) {
+        linear::Request request("echo", Payload(Now(), bench_->payload));
+        e = request.Send(socket);
+      } else {
+        linear::Notify notify("stream", Payload(Now(), bench_->payload));
+        e = notify.Send(socket);
+      }
+      if (e != linear::Error(linear::LNR_OK)) {
+        bench_->stats.RecordError();
+        failed++;
+      }
+    }
+    if (failed > 0 && bench_->config.pattern == PATTERN_REQUEST) {
+      Fill(socket, failed, false);
+    }
+  }
+
+ private:
+  struct State {
+    State() : sent(0), done(0), finished(false) {}
+    size_t sent;
+    size_t done;
+    bool finished;
+  };
+
+  linear::shared_ptr<Bench> bench_; // handlers may be called after Run returns
+  std::map<int, State> states_; // key: socket id, guarded by bench_->mutex
+};
+
+#ifdef WITH_SSL
+static linear::SSLContext ServerContext() {
+  linear::SSLContext context(linear::SSLContext::SSLv23_server);
+  if (!context.SetCertificate(std::string(SERVER_CERT)) ||
+      !context.SetPrivateKey(std::string(SERVER_PRIVATE_KEY))) {
+    std::cerr << "fail to load " << SERVER_CERT << " or " << SERVER_PRIVATE_KEY << std::endl;
+  }
+  return context;
+}
+
+static linear::SSLContext ClientContext() {
+  linear::SSLContext context(linear::SSLContext::SSLv23_client);
+  context.SetVerifyMode(linear::SSLContext::VERIFY_NONE);
+  return context;
+}
+#endif
+
+static linear::Server CreateServer(Transport transport, const linear::shared_ptr<linear::Handler>& handler) {
+  switch(transport) {
+  case TRANSPORT_TCP:
+    return linear::TCPServer(handler);
+  case TRANSPORT_WS:
+    return linear::WSServer(handler);
+#ifdef WITH_SSL
+  case TRANSPORT_SSL:
+    return linear::SSLServer(handler, ServerContext());
+  case TRANSPORT_WSS:
+    return linear::WSSServer(handler, ServerContext());
+#else
+  case TRANSPORT_SSL:
+  case TRANSPORT_WSS:
+#endif
+  default:
+    return linear::Server();
+  }
+}
+
+// create sockets and return the client, that must live while sockets are used
+static linear::Client CreateSockets(const Config& config, const linear::shared_ptr<linear::Handler>& handler,
+                                    std::vector<linear::Socket>* sockets) {
+  switch(config.transport) {
+  case TRANSPORT_TCP:
+    {
+      linear::TCPClient client(handler);
+      for (size_t i = 0; i < config.clients; i++) {
+        sockets->push_back(client.CreateSocket(config.host, config.port));
+      }
+      return client;
+    }
+  case TRANSPORT_WS:
+    {
+      linear::WSClient client(handler);
+      for (size_t i = 0; i < config.clients; i++) {
+        sockets->push_back(client.CreateSocket(config.host, config.port));
+      }
+      return client;
+    }
+#ifdef WITH_SSL
+  case TRANSPORT_SSL:
+    {
+      linear::SSLClient client(handler, ClientContext());
+      for (size_t i = 0; i < config.clients; i++) {
+        sockets->push_back(client.CreateSocket(config.host, config.port));
+      }
+      return client;
+    }
+  case TRANSPORT_WSS:
+    {
+      linear::WSSClient client(handler, ClientContext());
+      for (size_t i = 0; i < config.clients; i++) {
+        sockets->push_back(client.CreateSocket(config.host, config.port));
+      }
+      return client;
+    }
+#else
+  case TRANSPORT_SSL:
+  case TRANSPORT_WSS:
+#endif
+  default:
+    return linear::Client();
+  }
+}
+
+static bool Run(const Config& config) {
+  linear::shared_ptr<Bench> b = linear::shared_ptr<Bench>(new Bench(config));
+  Bench& bench = *b;
+  linear::shared_ptr<ServerHandler> sh = linear::shared_ptr<ServerHandler>(new ServerHandler(b));
+  linear::shared_ptr<ClientHandler> ch = linear::shared_ptr<ClientHandler>(new ClientHandler(b));
+
+  linear::Server server = CreateServer(config.transport, sh);
+  linear::Error e = server.Start(config.host, config.port);
+  if (e != linear::Error(linear::LNR_OK)) {
+    std::cerr << "fail to start server: " << e.Message() << std::endl;
+    return false;
+  }
+  std::vector<linear::Socket> sockets;
+  linear::Client client = CreateSockets(config, ch, &sockets);
+  for (std::vector<linear::Socket>::iterator it = sockets.begin(); it != sockets.end(); it++) {
+    it->Connect();
+  }
+
+  bool success = true;
+  linear::unique_lock<linear::mutex> lock(bench.mutex);
+  while ((bench.client_connected < config.clients || bench.server_connected < config.clients) &&
+         bench.disconnected == 0) {
+    bench.cv.wait(lock);
+  }
+  if (bench.disconnected > 0) {
+    std::cerr << "fail to connect" << std::endl;
+    success = false;
+  } else {
+    lock.unlock();
+    bench.stats.Start();
+    if (config.pattern == PATTERN_BROADCAST) {
+      for (size_t i = 0; i < config.num && success; i++) {
+        lock.lock();
+        // wait until less than depth of broadcasts are in flight
+        while (bench.received + config.depth * config.clients < (i + 1) * config.clients &&
+               bench.disconnected == 0) {
+          bench.cv.wait(lock);
+        }
+        success = (bench.disconnected == 0);
+        lock.unlock();
+        if (!success) {
+          break;
+        }
+        linear::Notify notify("broadcast", Payload(Now(), bench.payload));
+        notify.Send(BENCH_GROUP);
+      }
+      lock.lock();
+      while (bench.received < config.num * config.clients && bench.disconnected == 0) {
+        bench.cv.wait(lock);
+      }
+    } else {
+      for (std::vector<linear::Socket>::iterator it = sockets.begin(); it != sockets.end(); it++) {
+        ch->Fill(*it, 0, false);
+      }
+      lock.lock();
+      while (bench.finished < config.clients && bench.disconnected == 0) {
+        bench.cv.wait(lock);
+      }
+    }
+    if (bench.disconnected > 0) {
+      std::cerr << "disconnected while running" << std::endl;
+      success = false;
+    }
+  }
+  lock.unlock();
+
+  for (std::vector<linear::Socket>::iterator it = sockets.begin(); it != sockets.end(); it++) {
+    it->Disconnect();
+  }
+  server.Stop();
+  if (success) {
+    bench.stats.Report(config);
+  }
+  return success;
+}
+
+static void usage(char* name) {
+  std::cout << "linear benchmark suite." << std::endl;
+  std::cout << "run a server and clients in this process, and measure throughput and latency." << std::endl << std::endl;
+  std::cout << "Usage: " << std::string(name) << " [options] [Host := 127.0.0.1] [Port := 10000]" << std::endl;
+  std::cout << "[Options]" << std::endl;
+  std::cout << "  -t Type : Set transport, tcp, ssl, ws or wss.     default := tcp" << std::endl;
+  std::cout << "            ssl and wss read ./certs/server.pem and ./certs/server.key" << std::endl;
+  std::cout << "  -p Kind : Set pattern, request, notify or broadcast. default := request" << std::endl;
+  std::cout << "            request  : request and echo response from clients" << std::endl;
+  std::cout << "            notify   : notify streaming from clients to server" << std::endl;
+  std::cout << "            broadcast: notify to a group of all clients from server" << std::endl;
+  std::cout << "  -m Size : Set message size.                       default := 128bytes" << std::endl;
+  std::cout << "  -d Depth: Set num of messages in flight.          default := 1" << std::endl;
+  std::cout << "  -c Num  : Set num of client sockets.              default := 1" << std::endl;
+  std::cout << "  -n Num  : Set num of messages for each socket.    default := 10000times" << std::endl;
+  std::cout << "            (num of broadcasts for broadcast pattern)" << std::endl;
+  std::cout << "  -o Fmt  : Set output format, text, json or csv.   default := text" << std::endl;
+  std::cout << "[Debug option]" << std::endl;
+  std::cout << "  -l Level: Show log.                               default := off" << std::endl;
+  std::cout << "            ERR = 0, WARN = 1, INFO = 2, DEBUG = 3, FULL = 4" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  int ch, l;
+  extern char* optarg;
+  extern int optind;
+
+  Config config;
+  config.transport = TRANSPORT_TCP;
+  config.pattern = PATTERN_REQUEST;
+  config.format = FORMAT_TEXT;
+  config.msiz = DEFAULT_MSIZ;
+  config.depth = DEFAULT_DEPTH;
+  config.clients = DEFAULT_CLIENTS;
+  config.num = DEFAULT_NUM;
+  linear::log::Level level = linear::log::LOG_OFF;
+
+  while ((ch = getopt(argc, argv, "c:d:hl:m:n:o:p:t:")) != -1) {
+    std::string arg = (optarg != NULL) ? std::string(optarg) : std::string();
+    switch(ch) {
+    case 'c':
+      config.clients = (atoi(optarg) <= 0) ? DEFAULT_CLIENTS : atoi(optarg);
+      break;
+    case 'd':
+      config.depth = (atoi(optarg) <= 0) ? DEFAULT_DEPTH : atoi(optarg);
+      break;
+    case 'l':
+      l = atoi(optarg);
+      if (l >= 0) {
+        level = (l < 4) ? static_cast<linear::log::Level>(l) : LOG_FULL;
+      }
+      break;
+    case 'm':
+      config.msiz = (atoi(optarg) < 0) ? DEFAULT_MSIZ : atoi(optarg);
+      break;
+    case 'n':
+      config.num = (atoi(optarg) <= 0) ? DEFAULT_NUM : atoi(optarg);
+      break;
+    case 'o':
+      if (arg == "text") {
+        config.format = FORMAT_TEXT;
+      } else if (arg == "json") {
+        config.format = FORMAT_JSON;
+      } else if (arg == "csv") {
+        config.format = FORMAT_CSV;
+      } else {
+        usage(argv[0]);
+        return -1;
+      }
+      break;
+    case 'p':
+      if (arg == "request") {
+        config.pattern = PATTERN_REQUEST;
+      } else if (arg == "notify") {
+        config.pattern = PATTERN_NOTIFY;
+      } else if (arg == "broadcast") {
+        config.pattern = PATTERN_BROADCAST;
+      } else {
+        usage(argv[0]);
+        return -1;
+      }
+      break;
+    case 't':
+      if (arg == "tcp") {
+        config.transport = TRANSPORT_TCP;
+      } else if (arg == "ws") {
+        config.transport = TRANSPORT_WS;
+#ifdef WITH_SSL
+      } else if (arg == "ssl") {
+        config.transport = TRANSPORT_SSL;
+      } else if (arg == "wss") {
+        config.transport = TRANSPORT_WSS;
+#endif
+      } else {
+        std::cerr << "unsupported transport: " << arg << std::endl;
+        return -1;
+      }
+      break;
+    case 'h':
+    default:
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  argc -= optind;
+  argv += optind;
+
+  config.host = (argc >= 1) ? std::string(argv[0]) : "127.0.0.1";
+  config.port = (argc >= 2) ? atoi(argv[1]) : 10000;
+
+  if (level != LOG_OFF) {
+    linear::log::SetLevel(level);
+    linear::log::EnableStderr();
+  }
+
+  if (config.format == FORMAT_TEXT) {
+    std::cout << "--- Conditions ---" << std::endl;
+    std::cout << "Transport: " << TransportString(config.transport)
+              << ", Pattern: " << PatternString(config.pattern)
+              << ", Message size: " << config.msiz << "bytes"
+              << ", Depth: " << config.depth
+              << ", Clients: " << config.clients
+              << ", Num of try: " << config.num << std::endl;
+  }
+  if (!Run(config)) {
+    std::cerr << "bench fail" << std::endl;
+    return 1;
+  }
+  return 0;
+}
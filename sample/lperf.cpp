@@ -1,28 +1,44 @@
 // linear performance checker
 
+#include <time.h>
 #include <unistd.h>
-#include <sys/time.h>
 
 #include <iostream>
+#include <map>
 #include <string>
 #include <algorithm>
 #include <numeric>
+#include <vector>
 
 #include "linear/condition_variable.h"
+#include "linear/router.h"
 #include "linear/tcp_server.h"
 #include "linear/tcp_client.h"
 #include "linear/log.h"
 
 #define DEFAULT_TRY_NUM (1000)
 #define DEFAULT_MSIZ (128)
+#define DEFAULT_WINDOW (1)
+#define DEFAULT_RATE (0)
 
 using namespace linear::log;
 
 namespace receiver {
 
-class Handler : public linear::Handler {
+// reply params as they are, without decoding them
+static void Echo(const linear::Socket& socket, const linear::Message& msg) {
+  if (msg.type == linear::REQUEST) {
+    const linear::Request& request = static_cast<const linear::Request&>(msg);
+    linear::Response response(request.msgid, request.params);
+    response.Send(socket);
+  }
+}
+
+class Handler : public linear::Router {
  public:
-  Handler() {}
+  Handler() {
+    Add("echo", Echo);
+  }
   ~Handler() {}
 
   void OnConnect(const linear::Socket&) {
@@ -33,28 +49,6 @@ class Handler : public linear::Handler {
     linear::unique_lock<linear::mutex> lock(mutex_);
     cv_.notify_one();
   }
-  void OnMessage(const linear::Socket& socket, const linear::Message& msg) {
-    switch(msg.type) {
-    case linear::REQUEST:
-      {
-        const linear::Request& request = msg.as<linear::Request>();
-        if (request.method == "echo") {
-          linear::Response response(request.msgid, request.params);
-          response.Send(socket);
-        } else {
-          linear::Response response(request.msgid, linear::type::nil(), std::string("invalid method"));
-          response.Send(socket);
-        }
-        break;
-      }
-    case linear::NOTIFY:
-    case linear::RESPONSE:
-    default:
-      {
-        break;
-      }
-    }
-  }
   void WaitToFinish() {
     linear::unique_lock<linear::mutex> lock(mutex_);
     cv_.wait(lock);
@@ -69,44 +63,65 @@ class Handler : public linear::Handler {
 
 namespace sender {
 
+// monotonic clock (nsec)
+static uint64_t Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// closed loop (rate == 0): send next request when a response arrives, keeping window requests in flight.
+// open loop (rate > 0): send requests at a fixed rate from the main thread, and record latency from
+// the time each request was scheduled to be sent, so that waiting for the window is not omitted.
 class Handler : public linear::Handler {
  public:
-  Handler(size_t num, size_t msiz) : num_(num), msiz_(msiz) {}
+  Handler(size_t num, size_t msiz, size_t window, size_t rate)
+    : num_(num), msiz_(msiz), window_(window), rate_(rate), sent_(0), done_(0),
+      connected_(false), finished_(false), start_(0), end_(0) {}
   ~Handler() {}
 
   void OnConnect(const linear::Socket& socket) {
-    gettimeofday(&prev_, NULL);
-    linear::Request request("echo", std::string(msiz_, 'a'));
-    linear::Error e = request.Send(socket);
-    if (e.Code() != linear::LNR_OK) {
-      socket.Disconnect();
+    {
+      linear::unique_lock<linear::mutex> lock(mutex_);
+      socket_ = socket;
+      connected_ = true;
+      start_ = Now();
+      cv_.notify_all();
+    }
+    if (rate_ == 0) {
+      Fill();
     }
   }
   void OnDisconnect(const linear::Socket&, const linear::Error&) {
     linear::unique_lock<linear::mutex> lock(mutex_);
-    cv_.notify_one();
+    finished_ = true;
+    cv_.notify_all();
   }
   void OnMessage(const linear::Socket& socket, const linear::Message& msg) {
     switch(msg.type) {
     case linear::RESPONSE:
       {
+        uint64_t now = Now();
         linear::Response response = msg.as<linear::Response>();
-        struct timeval t;
-        gettimeofday(&t, NULL);
-        uint64_t d = (t.tv_sec - prev_.tv_sec) * 1000 * 1000 + (t.tv_usec - prev_.tv_usec);
-        duration_.push_back(d);
-        prev_ = t;
-        num_--;
-        if (num_ == 0) {
-          socket.Disconnect();
-          return;
-        }
-        linear::Request request("echo", std::string(msiz_, 'a'));
-        linear::Error e = request.Send(socket);
-        if (e.Code() != linear::LNR_OK) {
+        {
           linear::unique_lock<linear::mutex> lock(mutex_);
-          cv_.notify_one();
-          return;
+          std::map<uint32_t, uint64_t>::iterator it = scheduled_.find(response.msgid);
+          if (it == scheduled_.end()) {
+            return;
+          }
+          duration_.push_back(now - it->second);
+          scheduled_.erase(it);
+          end_ = now;
+          done_++;
+          cv_.notify_all();
+          if (done_ == num_) {
+            lock.unlock();
+            socket.Disconnect();
+            return;
+          }
+        }
+        if (rate_ == 0) {
+          Fill();
         }
         break;
       }
@@ -122,32 +137,107 @@ class Handler : public linear::Handler {
     socket.Disconnect();
   }
 
+  // send requests at rate_ per second until num_ requests are sent (open loop)
+  void Run() {
+    linear::unique_lock<linear::mutex> lock(mutex_);
+    while (!connected_ && !finished_) {
+      cv_.wait(lock);
+    }
+    uint64_t start = Now();
+    start_ = start;
+    lock.unlock();
+    for (size_t i = 0; i < num_; i++) {
+      uint64_t scheduled = start + static_cast<uint64_t>(i) * 1000000000 / rate_;
+      uint64_t now = Now();
+      if (scheduled > now) {
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>((scheduled - now) / 1000000000);
+        ts.tv_nsec = static_cast<long>((scheduled - now) % 1000000000);
+        nanosleep(&ts, NULL);
+      }
+      lock.lock();
+      while (sent_ - done_ >= window_ && !finished_) {
+        cv_.wait(lock);
+      }
+      if (finished_) {
+        return;
+      }
+      lock.unlock();
+      if (!Send(scheduled)) {
+        return;
+      }
+    }
+  }
   bool WaitToFinish() {
     linear::unique_lock<linear::mutex> lock(mutex_);
-    cv_.wait(lock);
-    return (num_ == 0);
+    while (!finished_) {
+      cv_.wait(lock);
+    }
+    return (done_ == num_);
   }
   void ShowResult() {
-    uint64_t max = *(duration_.begin()), min = *(duration_.begin()), ave;
-    for (std::vector<uint64_t>::iterator it = duration_.begin(); it != duration_.end(); it++) {
-      min = (*it < min) ? *it : min;
-      max = (max > *it) ? max : *it;
-    }
-    ave = std::accumulate(duration_.begin(), duration_.end(), 0) / duration_.size();
-    size_t midIndex = duration_.size() / 2;
-    std::nth_element(duration_.begin(), duration_.end() + midIndex, duration_.end());
+    std::sort(duration_.begin(), duration_.end());
+    uint64_t sum = std::accumulate(duration_.begin(), duration_.end(), static_cast<uint64_t>(0));
+    double elapsed = (end_ - start_) / 1000000000.0;
     std::cout << "--- Result ---" << std::endl;
     std::cout << "success: " << duration_.size() << ", RTT => "
-              << "min: " << min / 1000.0 << "ms, "
-              << "max: " << max / 1000.0 << "ms, "
-              << "ave: " << ave / 1000.0 << "ms, "
-              << "med: " << duration_[midIndex] / 1000.0 << "ms" << std::endl;
+              << "min: " << duration_.front() / 1000000.0 << "ms, "
+              << "max: " << duration_.back() / 1000000.0 << "ms, "
+              << "ave: " << sum / duration_.size() / 1000000.0 << "ms, "
+              << "p50: " << Percentile(500) / 1000000.0 << "ms, "
+              << "p99: " << Percentile(990) / 1000000.0 << "ms, "
+              << "p99.9: " << Percentile(999) / 1000000.0 << "ms" << std::endl;
+    std::cout << "throughput => " << ((elapsed > 0) ? duration_.size() / elapsed : 0) << "req/sec" << std::endl;
   }
 
  private:
+  // send requests until window_ requests are in flight (closed loop)
+  void Fill() {
+    for (;;) {
+      {
+        linear::unique_lock<linear::mutex> lock(mutex_);
+        if (sent_ == num_ || sent_ - done_ >= window_) {
+          return;
+        }
+      }
+      if (!Send(Now())) {
+        return;
+      }
+    }
+  }
+  bool Send(uint64_t scheduled) {
+    linear::Request request("echo", std::string(msiz_, 'a'));
+    linear::Socket socket;
+    {
+      linear::unique_lock<linear::mutex> lock(mutex_);
+      scheduled_[request.msgid] = scheduled;
+      sent_++;
+      socket = socket_;
+    }
+    linear::Error e = request.Send(socket);
+    if (e.Code() != linear::LNR_OK) {
+      socket.Disconnect();
+      return false;
+    }
+    return true;
+  }
+  // nearest rank percentile of sorted duration
+  uint64_t Percentile(size_t per_mille) {
+    size_t rank = (duration_.size() * per_mille + 999) / 1000;
+    return duration_[(rank == 0) ? 0 : rank - 1];
+  }
+
   size_t num_;
   size_t msiz_;
-  struct timeval prev_;
+  size_t window_;
+  size_t rate_;
+  size_t sent_;
+  size_t done_;
+  bool connected_;
+  bool finished_;
+  uint64_t start_, end_;
+  linear::Socket socket_;
+  std::map<uint32_t, uint64_t> scheduled_; // key: msgid, value: time scheduled to send
   std::vector<uint64_t> duration_;
   linear::mutex mutex_;
   linear::condition_variable cv_;
@@ -168,6 +258,9 @@ void usage(char* name) {
   std::cout << "[Sender option]" << std::endl;
   std::cout << "  -m Size : Set message size.                       default := 128bytes" << std::endl;
   std::cout << "  -n Num  : Set num of try.                         default := 1000times" << std::endl;
+  std::cout << "  -w Num  : Set num of requests in flight.          default := 1" << std::endl;
+  std::cout << "  -r Rate : Send requests at Rate per sec (open loop). default := 0 (closed loop)" << std::endl;
+  std::cout << "            latency includes time waiting for the window from the scheduled time" << std::endl;
   std::cout << "[Debug option]" << std::endl;
   std::cout << "  -l Level: Show log.                               default := off" << std::endl;
   std::cout << "            ERR = 0, WARN = 1, INFO = 2, DEBUG = 3, FULL = 4" << std::endl;
@@ -192,10 +285,10 @@ int main(int argc, char* argv[]) {
   char t = '\0';
   NodeType type = UNDEFINED;
   NodeMode mode = SENDER;
-  size_t num = DEFAULT_TRY_NUM, msiz = DEFAULT_MSIZ;
+  size_t num = DEFAULT_TRY_NUM, msiz = DEFAULT_MSIZ, window = DEFAULT_WINDOW, rate = DEFAULT_RATE;
   linear::log::Level level = linear::log::LOG_OFF;
 
-  while ((ch = getopt(argc, argv, "c:l:m:n:s:")) != -1) {
+  while ((ch = getopt(argc, argv, "c:l:m:n:r:s:w:")) != -1) {
     switch(ch) {
     case 'c':
       type = CLIENT;
@@ -215,10 +308,16 @@ int main(int argc, char* argv[]) {
       num = atoi(optarg);
       num = (num <= 0) ? DEFAULT_TRY_NUM : num;
       break;
+    case 'r':
+      rate = (atoi(optarg) <= 0) ? DEFAULT_RATE : atoi(optarg);
+      break;
     case 's':
       type = SERVER;
       t = *optarg;
       break;
+    case 'w':
+      window = (atoi(optarg) <= 0) ? DEFAULT_WINDOW : atoi(optarg);
+      break;
     default:
       usage(argv[0]);
       return -1;
@@ -276,11 +375,15 @@ int main(int argc, char* argv[]) {
         std::cout << "Run as a client to send a request" << std::endl;
         std::cout << "--- Conditions ---" << std::endl;
         std::cout << "Target: " << host << ":" << port
-                  << ", Num of try: " << num << ", Message size: " << msiz << "bytes" << std::endl;
-        linear::shared_ptr<sender::Handler> h = linear::shared_ptr<sender::Handler>(new sender::Handler(num, msiz));
+                  << ", Num of try: " << num << ", Message size: " << msiz << "bytes"
+                  << ", Window: " << window << ", Rate: " << rate << "req/sec" << std::endl;
+        linear::shared_ptr<sender::Handler> h = linear::shared_ptr<sender::Handler>(new sender::Handler(num, msiz, window, rate));
         linear::TCPClient c(h);
         linear::TCPSocket s = c.CreateSocket(host, port);
         s.Connect();
+        if (rate > 0) {
+          h->Run();
+        }
         if (h->WaitToFinish()) {
           h->ShowResult();
         } else {
@@ -310,10 +413,14 @@ int main(int argc, char* argv[]) {
         std::cout << "Run as a server to send a request" << std::endl;
         std::cout << "--- Conditions ---" << std::endl;
         std::cout << "Server started: " << host << ":" << port
-                  << ", Num of try: " << num << ", Message size: " << msiz << "bytes" << std::endl;
-        linear::shared_ptr<sender::Handler> h = linear::shared_ptr<sender::Handler>(new sender::Handler(num, msiz));
+                  << ", Num of try: " << num << ", Message size: " << msiz << "bytes"
+                  << ", Window: " << window << ", Rate: " << rate << "req/sec" << std::endl;
+        linear::shared_ptr<sender::Handler> h = linear::shared_ptr<sender::Handler>(new sender::Handler(num, msiz, window, rate));
         linear::TCPServer s(h);
         s.Start(host, port);
+        if (rate > 0) {
+          h->Run();
+        }
         if (h->WaitToFinish()) {
           h->ShowResult();
         } else {
@@ -0,0 +1,61 @@
+#ifndef LINEAR_ATOMIC_H_
+#define LINEAR_ATOMIC_H_
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+# include <windows.h>
+#elif !defined(__GNUC__)
+# include "linear/mutex.h"
+#endif
+
+namespace linear {
+
+#if !defined(_WIN32) && !defined(__GNUC__)
+// fallback for compilers without atomic builtins
+inline linear::mutex& GetAtomicMutex() {
+  static linear::mutex m;
+  return m;
+}
+#endif
+
+// increment value without lock and return the value before increment.
+// value must be a static or member variable that is shared by all threads.
+inline uint32_t AtomicFetchAndIncrement(volatile uint32_t* value) {
+#if defined(_WIN32)
+  return static_cast<uint32_t>(InterlockedIncrement(reinterpret_cast<volatile LONG*>(value))) - 1;
+#elif defined(__GNUC__)
+  return __sync_fetch_and_add(value, 1);
+#else
+  linear::lock_guard<linear::mutex> lock(GetAtomicMutex());
+  return (*value)++;
+#endif
+}
+
+// add delta to value without lock.
+// used for counters that are updated by one thread and read by others.
+inline void AtomicAdd(volatile uint64_t* value, uint64_t delta) {
+#if defined(_WIN32)
+  InterlockedExchangeAdd64(reinterpret_cast<volatile LONGLONG*>(value), static_cast<LONGLONG>(delta));
+#elif defined(__GNUC__)
+  __sync_fetch_and_add(value, delta);
+#else
+  linear::lock_guard<linear::mutex> lock(GetAtomicMutex());
+  *value += delta;
+#endif
+}
+
+inline uint64_t AtomicLoad(volatile uint64_t* value) {
+#if defined(_WIN32)
+  return static_cast<uint64_t>(InterlockedCompareExchange64(reinterpret_cast<volatile LONGLONG*>(value), 0, 0));
+#elif defined(__GNUC__)
+  return __sync_fetch_and_add(value, 0);
+#else
+  linear::lock_guard<linear::mutex> lock(GetAtomicMutex());
+  return *value;
+#endif
+}
+
+}  // namespace linear
+
+#endif  // LINEAR_ATOMIC_H_
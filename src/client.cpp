@@ -0,0 +1,15 @@
+#include "linear/client.h"
+
+#include "client_impl.h"
+
+namespace linear {
+
+Error Client::SetDispatcher(const Dispatcher& dispatcher) const {
+  if (!client_) {
+    return Error(LNR_EINVAL);
+  }
+  client_->SetDispatcher(dispatcher.GetImpl());
+  return Error(LNR_OK);
+}
+
+} // namespace linear
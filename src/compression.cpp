@@ -0,0 +1,90 @@
+#include <cstdlib>
+
+#ifdef WITH_ZLIB
+# include <zlib.h>
+#endif
+
+#include "compression.h"
+
+namespace linear {
+
+namespace compression {
+
+#define COMPRESSION_HEADER_SIZE (4)
+
+#ifdef WITH_ZLIB
+
+bool Available() {
+  return true;
+}
+
+bool Compress(const char* data, size_t size, std::vector<char>* out) {
+  if (size <= COMPRESSION_HEADER_SIZE || size > 0xffffffff) {
+    return false;
+  }
+  uLongf bound = compressBound(static_cast<uLong>(size));
+  try {
+    out->resize(COMPRESSION_HEADER_SIZE + bound);
+  } catch(...) {
+    return false;
+  }
+  // favor speed, because messages are compressed while the send lock of the socket is held
+  int ret = compress2(reinterpret_cast<Bytef*>(&(*out)[COMPRESSION_HEADER_SIZE]), &bound,
+                      reinterpret_cast<const Bytef*>(data), static_cast<uLong>(size), Z_BEST_SPEED);
+  if (ret != Z_OK || COMPRESSION_HEADER_SIZE + bound >= size) {
+    return false;
+  }
+  uint32_t raw = static_cast<uint32_t>(size);
+  (*out)[0] = static_cast<char>((raw >> 24) & 0xff);
+  (*out)[1] = static_cast<char>((raw >> 16) & 0xff);
+  (*out)[2] = static_cast<char>((raw >> 8) & 0xff);
+  (*out)[3] = static_cast<char>(raw & 0xff);
+  out->resize(COMPRESSION_HEADER_SIZE + bound);
+  return true;
+}
+
+char* Decompress(const char* data, size_t size, size_t limit, size_t* decompressed_size) {
+  if (size <= COMPRESSION_HEADER_SIZE) {
+    return NULL;
+  }
+  const unsigned char* header = reinterpret_cast<const unsigned char*>(data);
+  size_t raw = (static_cast<size_t>(header[0]) << 24) | (static_cast<size_t>(header[1]) << 16) |
+    (static_cast<size_t>(header[2]) << 8) | static_cast<size_t>(header[3]);
+  if (raw == 0 || raw > limit) {
+    return NULL;
+  }
+  char* buffer = static_cast<char*>(malloc(raw));
+  if (buffer == NULL) {
+    return NULL;
+  }
+  uLongf length = static_cast<uLongf>(raw);
+  int ret = uncompress(reinterpret_cast<Bytef*>(buffer), &length,
+                       reinterpret_cast<const Bytef*>(data + COMPRESSION_HEADER_SIZE),
+                       static_cast<uLong>(size - COMPRESSION_HEADER_SIZE));
+  if (ret != Z_OK || length != raw) {
+    free(buffer);
+    return NULL;
+  }
+  *decompressed_size = raw;
+  return buffer;
+}
+
+#else  // WITH_ZLIB
+
+bool Available() {
+  return false;
+}
+
+bool Compress(const char*, size_t, std::vector<char>*) {
+  return false;
+}
+
+char* Decompress(const char*, size_t, size_t, size_t*) {
+  return NULL;
+}
+
+#endif  // WITH_ZLIB
+
+}  // namespace compression
+
+}  // namespace linear
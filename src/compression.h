@@ -0,0 +1,32 @@
+#ifndef LINEAR_COMPRESSION_H_
+#define LINEAR_COMPRESSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace linear {
+
+namespace compression {
+
+// msgpack ext type that wraps a compressed message in place of the message itself.
+// messages are arrays, so the wrapper never collides with them.
+const int8_t EXT_TYPE = 1;
+
+// return true when built with zlib
+bool Available();
+
+// compress data into out as [size of data (4 bytes, big endian)][zlib stream].
+// return false when fails or the result is not smaller than data, and then data should be sent as is.
+bool Compress(const char* data, size_t size, std::vector<char>* out);
+
+// return data decompressed into a buffer allocated by malloc, and set its size.
+// return NULL when data is broken, bigger than limit after decompressed or out of memory.
+char* Decompress(const char* data, size_t size, size_t limit, size_t* decompressed_size);
+
+}  // namespace compression
+
+}  // namespace linear
+
+#endif  // LINEAR_COMPRESSION_H_
@@ -0,0 +1,149 @@
+#include <cassert>
+#include <cstdlib>
+
+#include "linear/log.h"
+
+#include "deadline_queue.h"
+
+using namespace linear::log;
+
+namespace linear {
+
+static uint64_t Now() {
+  return uv_hrtime() / 1000000; // msec
+}
+
+DeadlineQueue::DeadlineQueue(tv_loop_t* loop)
+  : loop_(loop), tv_timer_(NULL), seq_(0), armed_(0), lag_(0), max_lag_(0), probing_(false), probe_(0, 0) {
+}
+
+DeadlineQueue::~DeadlineQueue() {
+  lock_guard<mutex> lock(mutex_);
+  if (tv_timer_ == NULL) {
+    return;
+  }
+  static_cast<EventLoopImpl::DeadlineEvent*>(tv_timer_->data)->queue = NULL;
+  tv_timer_stop(tv_timer_);
+  tv_close(reinterpret_cast<tv_handle_t*>(tv_timer_), EventLoopImpl::OnClose);
+}
+
+Error DeadlineQueue::Add(TimerCallback callback, unsigned int timeout, void* args, DeadlineQueue::Key* key) {
+  assert(callback != NULL && key != NULL);
+  uint64_t now = Now();
+  lock_guard<mutex> lock(mutex_);
+  return _Add(callback, timeout, args, now, key);
+}
+
+void DeadlineQueue::Remove(const DeadlineQueue::Key& key) {
+  lock_guard<mutex> lock(mutex_);
+  queue_.erase(key);
+}
+
+size_t DeadlineQueue::Size() {
+  lock_guard<mutex> lock(mutex_);
+  return queue_.size() - queue_.count(probe_);
+}
+
+void DeadlineQueue::GetMetrics(EventLoopMetrics* metrics) {
+  uint64_t now = Now();
+  lock_guard<mutex> lock(mutex_);
+  if (!probing_) {
+    probing_ = (_Add(DeadlineQueue::OnProbe, DEADLINE_QUEUE_PROBE_INTERVAL, this, now, &probe_) == Error(LNR_OK));
+  }
+  metrics->lag = lag_;
+  // the loop is blocked, if the earliest deadline is passed and its timeout is not fired yet
+  if (!queue_.empty() && queue_.begin()->first.first < now &&
+      now - queue_.begin()->first.first > metrics->lag) {
+    metrics->lag = now - queue_.begin()->first.first;
+  }
+  metrics->max_lag = (metrics->lag > max_lag_) ? metrics->lag : max_lag_;
+  metrics->timeouts = queue_.size() - queue_.count(probe_);
+}
+
+// add the probe again, so that OnTimer samples lag at least every interval
+void DeadlineQueue::OnProbe(void* args) {
+  DeadlineQueue* queue = static_cast<DeadlineQueue*>(args);
+  uint64_t now = Now();
+  lock_guard<mutex> lock(queue->mutex_);
+  queue->probing_ = (queue->_Add(DeadlineQueue::OnProbe, DEADLINE_QUEUE_PROBE_INTERVAL, queue, now,
+                                 &queue->probe_) == Error(LNR_OK));
+}
+
+// mutex_ must be locked.
+Error DeadlineQueue::_Add(TimerCallback callback, unsigned int timeout, void* args, uint64_t now,
+                          DeadlineQueue::Key* key) {
+  if (tv_timer_ == NULL) {
+    EventLoopImpl::DeadlineEvent* ev = NULL;
+    try {
+      ev = new EventLoopImpl::DeadlineEvent(this);
+    } catch(...) {
+      return Error(LNR_ENOMEM);
+    }
+    tv_timer_ = static_cast<tv_timer_t*>(malloc(sizeof(tv_timer_t)));
+    if (tv_timer_ == NULL) {
+      delete ev;
+      return Error(LNR_ENOMEM);
+    }
+    int ret = tv_timer_init(loop_, tv_timer_);
+    if (ret) {
+      LINEAR_LOG(LOG_ERR, "fail to start timer: %s", tv_strerror(reinterpret_cast<tv_handle_t*>(tv_timer_), ret));
+      free(tv_timer_);
+      tv_timer_ = NULL;
+      delete ev;
+      return Error(ret);
+    }
+    tv_timer_->data = ev;
+  }
+  DeadlineQueue::Key k(now + timeout, ++seq_);
+  try {
+    queue_.insert(std::make_pair(k, DeadlineQueue::Entry(callback, args)));
+  } catch(...) {
+    return Error(LNR_ENOMEM);
+  }
+  Error e = _Arm(now);
+  if (e != Error(LNR_OK)) {
+    queue_.erase(k);
+    return e;
+  }
+  *key = k;
+  return Error(LNR_OK);
+}
+
+void DeadlineQueue::OnTimer() {
+  uint64_t now = Now();
+  unique_lock<mutex> lock(mutex_);
+  armed_ = 0;
+  if (!queue_.empty() && queue_.begin()->first.first <= now) {
+    lag_ = now - queue_.begin()->first.first;
+    max_lag_ = (lag_ > max_lag_) ? lag_ : max_lag_;
+  }
+  // pop one by one, so that a callback can remove the other expired timeouts
+  while (!queue_.empty() && queue_.begin()->first.first <= now) {
+    DeadlineQueue::Entry entry = queue_.begin()->second;
+    queue_.erase(queue_.begin());
+    lock.unlock();
+    (*entry.callback)(entry.args);
+    lock.lock();
+  }
+  if (!queue_.empty()) {
+    _Arm(now);
+  }
+}
+
+// start tv_timer for the earliest deadline unless it is already started for an earlier one.
+// mutex_ must be locked.
+Error DeadlineQueue::_Arm(uint64_t now) {
+  uint64_t deadline = queue_.begin()->first.first;
+  if (armed_ != 0 && armed_ <= deadline) {
+    return Error(LNR_OK);
+  }
+  int ret = tv_timer_start(tv_timer_, EventLoopImpl::OnDeadline, (deadline > now) ? (deadline - now) : 0, 0);
+  if (ret) {
+    LINEAR_LOG(LOG_ERR, "fail to start timer: %s", tv_strerror(reinterpret_cast<tv_handle_t*>(tv_timer_), ret));
+    return Error(ret);
+  }
+  armed_ = deadline;
+  return Error(LNR_OK);
+}
+
+}  // namespace linear
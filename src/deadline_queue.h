@@ -0,0 +1,63 @@
+#ifndef LINEAR_DEADLINE_QUEUE_H_
+#define LINEAR_DEADLINE_QUEUE_H_
+
+#include <map>
+#include <utility>
+
+#include "linear/error.h"
+#include "linear/metrics.h"
+#include "linear/mutex.h"
+#include "linear/timer.h"
+
+#include "event_loop_impl.h"
+
+#define DEADLINE_QUEUE_PROBE_INTERVAL (1000) // msec
+
+namespace linear {
+
+// timeouts of an event loop ordered by deadline, and fired by a single tv_timer.
+// adding or removing a timeout needs neither a handle nor a tv_close.
+class DeadlineQueue {
+ public:
+  // (deadline (msec), sequence number)
+  typedef std::pair<uint64_t, uint64_t> Key;
+
+  DeadlineQueue(tv_loop_t* loop);
+  ~DeadlineQueue();
+  // callback(args) is called in the event loop thread after timeout (msec)
+  linear::Error Add(linear::TimerCallback callback, unsigned int timeout, void* args,
+                    linear::DeadlineQueue::Key* key);
+  // callback of key is never called after Remove returned in the event loop thread
+  void Remove(const linear::DeadlineQueue::Key& key);
+  size_t Size();
+  // lag is how late the earliest expired timeout is fired, or is overdue now.
+  // the first call starts a probe timeout that keeps lag sampled while no other timeouts fire.
+  void GetMetrics(linear::EventLoopMetrics* metrics);
+  void OnTimer();
+
+ private:
+  struct Entry {
+    Entry(linear::TimerCallback c, void* a) : callback(c), args(a) {}
+    linear::TimerCallback callback;
+    void* args;
+  };
+
+  static void OnProbe(void* args);
+  linear::Error _Add(linear::TimerCallback callback, unsigned int timeout, void* args,
+                     uint64_t now, linear::DeadlineQueue::Key* key);
+  linear::Error _Arm(uint64_t now);
+
+  tv_loop_t* loop_;
+  tv_timer_t* tv_timer_;
+  uint64_t seq_;
+  uint64_t armed_; // deadline the tv_timer is started for, 0 if not started
+  uint64_t lag_, max_lag_;
+  bool probing_;
+  linear::DeadlineQueue::Key probe_; // not counted as a timeout of metrics
+  std::map<linear::DeadlineQueue::Key, linear::DeadlineQueue::Entry> queue_;
+  linear::mutex mutex_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_DEADLINE_QUEUE_H_
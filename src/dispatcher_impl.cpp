@@ -0,0 +1,225 @@
+#include "linear/dispatcher.h"
+#include "linear/log.h"
+
+#include "atomic.h"
+#include "dispatcher_impl.h"
+#include "handler_delegate.h"
+#include "socket_impl.h"
+
+using namespace linear::log;
+
+namespace linear {
+
+Dispatcher::Dispatcher(size_t num_threads) : dispatcher_(new DispatcherImpl(num_threads)) {
+}
+
+Dispatcher::~Dispatcher() {
+}
+
+const shared_ptr<DispatcherImpl> Dispatcher::GetImpl() const {
+  return dispatcher_;
+}
+
+DispatcherImpl::DispatcherImpl(size_t num_threads)
+  : threads_(0), next_(0), ready_(0), running_(true) {
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  // all workers are created before threads start, because they steal from each other.
+  // strands pushed to a worker without thread are stolen by the others.
+  for (size_t i = 0; i < num_threads; i++) {
+    workers_.push_back(new Worker(this, i));
+  }
+  for (; threads_ < workers_.size(); threads_++) {
+    if (uv_thread_create(&workers_[threads_]->thread, DispatcherImpl::Run, workers_[threads_]) != 0) {
+      LINEAR_LOG(LOG_ERR, "fail to create worker threads of dispatcher: %u/%u",
+                 static_cast<unsigned int>(threads_), static_cast<unsigned int>(workers_.size()));
+      break;
+    }
+  }
+  if (threads_ == 0) {
+    running_ = false;
+  }
+}
+
+// stop workers after they run all queued events.
+// a worker that drops the last reference in a handler cannot join itself, so it is detached,
+// and exits without touching the dispatcher after the handler returns.
+DispatcherImpl::~DispatcherImpl() {
+  unique_lock<mutex> lock(mutex_);
+  running_ = false;
+  cond_.notify_all();
+  lock.unlock();
+  uv_thread_t self = uv_thread_self();
+  Worker* orphan = NULL;
+  for (size_t i = 0; i < threads_; i++) {
+    if (uv_thread_equal(&workers_[i]->thread, &self)) {
+      orphan = workers_[i];
+      continue;
+    }
+    uv_thread_join(&workers_[i]->thread);
+  }
+  for (std::vector<Worker*>::iterator it = workers_.begin(); it != workers_.end(); it++) {
+    if (*it == orphan) {
+      LINEAR_LOG(LOG_DEBUG, "dispatcher is destroyed in worker thread: %u", static_cast<unsigned int>(orphan->index));
+      orphan->orphaned = true;
+      Detach(&orphan->thread);
+    } else {
+      delete *it;
+    }
+  }
+}
+
+Error DispatcherImpl::Post(const Event& event) {
+  unique_lock<mutex> lock(mutex_);
+  if (!running_) {
+    // no worker is started, and no event is queued before, so the order is kept
+    lock.unlock();
+    Fire(event);
+    return Error(LNR_OK);
+  }
+  lock.unlock();
+  shared_ptr<Strand> strand;
+  unique_lock<mutex> strands_lock(strands_mutex_);
+  try {
+    shared_ptr<Strand>& s = strands_[event.socket->GetId()];
+    if (!s) {
+      s = shared_ptr<Strand>(new Strand(event.socket->GetId()));
+    }
+    s->events.push_back(event);
+    s->closed = (event.type == ON_DISCONNECT);
+    if (s->scheduled) {
+      return Error(LNR_OK);
+    }
+    s->scheduled = true;
+    strand = s;
+  } catch(...) {
+    return Error(LNR_ENOMEM);
+  }
+  strands_lock.unlock();
+  _Schedule(AtomicFetchAndIncrement(&next_) % workers_.size(), strand);
+  return Error(LNR_OK);
+}
+
+void DispatcherImpl::Run(void* arg) {
+  Worker* worker = static_cast<Worker*>(arg);
+  worker->dispatcher->_Run(worker->index);
+  if (worker->orphaned) {
+    delete worker;
+  }
+}
+
+void DispatcherImpl::Detach(uv_thread_t* thread) {
+#ifdef _WIN32
+  CloseHandle(*thread);
+#else
+  pthread_detach(*thread);
+#endif
+}
+
+void DispatcherImpl::Fire(const Event& event) {
+  switch(event.type) {
+  case ON_CONNECT:
+    HandlerDelegate::CallOnConnect(event.handler, event.socket);
+    break;
+  case ON_DISCONNECT:
+    HandlerDelegate::CallOnDisconnect(event.handler, event.socket, event.error);
+    break;
+  case ON_MESSAGE:
+    HandlerDelegate::CallOnMessage(event.handler, event.socket, *event.message);
+    break;
+  case ON_ERROR:
+    HandlerDelegate::CallOnError(event.handler, event.socket, *event.message, event.error);
+    break;
+  case ON_WRITABLE:
+    HandlerDelegate::CallOnWritable(event.handler, event.socket);
+    break;
+  default:
+    LINEAR_LOG(LOG_ERR, "BUG: invalid type of event");
+    assert(false);
+  }
+}
+
+void DispatcherImpl::_Run(size_t index) {
+  Worker* worker = workers_[index];
+  while (true) {
+    unique_lock<mutex> lock(mutex_);
+    while (running_ && ready_ == 0) {
+      cond_.wait(lock);
+    }
+    if (ready_ == 0) {
+      break; // stopped and all strands are run
+    }
+    ready_--;
+    lock.unlock();
+    // a strand is surely in some deque for the count taken above
+    shared_ptr<Strand> strand;
+    while (!(strand = _Take(index))) {
+    }
+    _RunStrand(index, strand);
+    if (worker->orphaned) {
+      break;
+    }
+  }
+}
+
+void DispatcherImpl::_RunStrand(size_t index, const shared_ptr<Strand>& strand) {
+  Worker* worker = workers_[index];
+  for (size_t i = 0; ; i++) {
+    unique_lock<mutex> strands_lock(strands_mutex_);
+    if (strand->events.empty()) {
+      strand->scheduled = false;
+      if (strand->closed) {
+        // the socket is disconnected, and a new strand is created if it connects again
+        strands_.erase(strand->id);
+      }
+      return;
+    }
+    if (i == MAX_BATCH) {
+      // yield the worker to the other strands, and let the strand be stolen if this worker is busy
+      strands_lock.unlock();
+      _Schedule(index, strand);
+      return;
+    }
+    Event event = strand->events.front();
+    strand->events.pop_front();
+    strands_lock.unlock();
+    Fire(event);
+    if (worker->orphaned) {
+      return; // the rest of events are dropped with the dispatcher
+    }
+  }
+}
+
+void DispatcherImpl::_Schedule(size_t index, const shared_ptr<Strand>& strand) {
+  Worker* worker = workers_[index];
+  unique_lock<mutex> worker_lock(worker->mutex);
+  worker->ready.push_back(strand);
+  worker_lock.unlock();
+  lock_guard<mutex> lock(mutex_);
+  ready_++;
+  cond_.notify_one();
+}
+
+// take the oldest strand of own deque, or steal the newest one from the others
+shared_ptr<DispatcherImpl::Strand> DispatcherImpl::_Take(size_t index) {
+  shared_ptr<Strand> strand;
+  for (size_t i = 0; i < workers_.size(); i++) {
+    Worker* worker = workers_[(index + i) % workers_.size()];
+    lock_guard<mutex> worker_lock(worker->mutex);
+    if (worker->ready.empty()) {
+      continue;
+    }
+    if (i == 0) {
+      strand = worker->ready.front();
+      worker->ready.pop_front();
+    } else {
+      strand = worker->ready.back();
+      worker->ready.pop_back();
+    }
+    break;
+  }
+  return strand;
+}
+
+}  // namespace linear
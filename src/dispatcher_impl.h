@@ -0,0 +1,93 @@
+#ifndef LINEAR_DISPATCHER_IMPL_H_
+#define LINEAR_DISPATCHER_IMPL_H_
+
+#include <deque>
+#include <vector>
+
+#include "uv.h"
+
+#include "linear/condition_variable.h"
+#include "linear/error.h"
+#include "linear/handler.h"
+#include "linear/message.h"
+
+#include "unordered.h"
+
+namespace linear {
+
+class SocketImpl;
+
+// call Handler callbacks in worker threads instead of event loop threads.
+// events of a socket are queued to its strand, and a strand runs on one worker at a time,
+// so that callbacks of a socket are called in order.
+// strands ready to run are pushed to the deque of a worker, and idle workers steal them from the others.
+class DispatcherImpl {
+ public:
+  enum EventType {
+    ON_CONNECT,
+    ON_DISCONNECT,
+    ON_MESSAGE,
+    ON_ERROR,
+    ON_WRITABLE
+  };
+  struct Event {
+    Event(EventType t, const linear::weak_ptr<linear::Handler>& h,
+          const linear::shared_ptr<linear::SocketImpl>& s)
+      : type(t), handler(h), socket(s), message(), error(LNR_OK) {}
+    EventType type;
+    linear::weak_ptr<linear::Handler> handler;
+    linear::shared_ptr<linear::SocketImpl> socket;
+    linear::shared_ptr<linear::Message> message; // copy of the message for ON_MESSAGE and ON_ERROR
+    linear::Error error;
+  };
+
+  static const size_t MAX_BATCH = 32; // events run at once before the strand yields the worker
+
+  DispatcherImpl(size_t num_threads);
+  ~DispatcherImpl();
+  // return an error when the event is not queued.
+  // the event is fired in the caller thread when no worker thread is started.
+  linear::Error Post(const linear::DispatcherImpl::Event& event);
+
+ private:
+  struct Strand {
+    Strand(int i) : id(i), scheduled(false), closed(false) {}
+    int id;         // socket id
+    std::deque<linear::DispatcherImpl::Event> events;
+    bool scheduled; // pushed to a worker or running
+    bool closed;    // last queued event is ON_DISCONNECT
+  };
+  struct Worker {
+    Worker(linear::DispatcherImpl* d, size_t i) : dispatcher(d), index(i), orphaned(false) {}
+    linear::DispatcherImpl* dispatcher;
+    size_t index;
+    bool orphaned;  // the dispatcher is destroyed in this worker, so the worker must not touch it
+    uv_thread_t thread;
+    std::deque<linear::shared_ptr<linear::DispatcherImpl::Strand> > ready;
+    linear::mutex mutex;
+  };
+
+  DispatcherImpl(const DispatcherImpl& rhs);
+  DispatcherImpl& operator=(const DispatcherImpl& rhs);
+  static void Run(void* arg);
+  static void Fire(const linear::DispatcherImpl::Event& event);
+  static void Detach(uv_thread_t* thread);
+  void _Run(size_t index);
+  void _RunStrand(size_t index, const linear::shared_ptr<linear::DispatcherImpl::Strand>& strand);
+  void _Schedule(size_t index, const linear::shared_ptr<linear::DispatcherImpl::Strand>& strand);
+  linear::shared_ptr<linear::DispatcherImpl::Strand> _Take(size_t index);
+
+  std::vector<linear::DispatcherImpl::Worker*> workers_;
+  size_t threads_;         // number of workers whose thread is started
+  volatile uint32_t next_; // round robin index of workers to push strands
+  linear::unordered_map<int, linear::shared_ptr<linear::DispatcherImpl::Strand> > strands_; // key: socket id
+  linear::mutex strands_mutex_; // guards strands_ and events of every strand
+  size_t ready_;                // number of strands in the deques of workers
+  bool running_;
+  linear::mutex mutex_;         // guards ready_ and running_
+  linear::condition_variable cond_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_DISPATCHER_IMPL_H_
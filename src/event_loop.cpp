@@ -1,5 +1,6 @@
 #include "linear/event_loop.h"
 
+#include "deadline_queue.h"
 #include "event_loop_impl.h"
 
 namespace linear {
@@ -20,4 +21,10 @@ const linear::shared_ptr<linear::EventLoopImpl> EventLoop::GetImpl() const {
   return loop_;
 }
 
+EventLoopMetrics EventLoop::GetMetrics() const {
+  EventLoopMetrics metrics;
+  loop_->GetDeadlineQueue()->GetMetrics(&metrics);
+  return metrics;
+}
+
 } // namespace linear
@@ -1,7 +1,9 @@
 #include <cstdlib>
 
+#include "deadline_queue.h"
 #include "server_impl.h"
 #include "timer_impl.h"
+#include "write_buffer_pool.h"
 
 using namespace linear::log;
 
@@ -55,6 +57,12 @@ void EventLoopImpl::OnClose(tv_handle_t* handle) {
       delete ev;
     }
     break;
+  case DEADLINE:
+    {
+      DeadlineEvent* ev = static_cast<DeadlineEvent*>(handle->data);
+      delete ev;
+    }
+    break;
   default:
     LINEAR_LOG(LOG_ERR, "BUG: invalid type of event");
     assert(false);
@@ -74,14 +82,15 @@ void EventLoopImpl::OnWrite(tv_write_t* request, int status) {
   assert(request != NULL && request->data != NULL &&
          request->handle != NULL && request->handle->data != NULL &&
          request->buf.base != NULL);
-  Message* message = static_cast<Message*>(request->data);
+  WriteBuffer* buffer = static_cast<WriteBuffer*>(request->data);
   SocketEvent* ev = static_cast<SocketEvent*>(request->handle->data);
   if (linear::shared_ptr<SocketImpl> socket = ev->socket.lock()) {
-    socket->OnWrite(socket, message, status);
+    socket->OnWrite(socket, buffer, status);
   }
-  delete message;
-  free(request->buf.base);
-  free(request);
+  for (std::vector<Message*>::iterator it = buffer->messages.begin(); it != buffer->messages.end(); it++) {
+    delete *it;
+  }
+  WriteBufferPool::Release(buffer);
 }
 
 void EventLoopImpl::OnTimer(tv_timer_t* handle) {
@@ -92,6 +101,14 @@ void EventLoopImpl::OnTimer(tv_timer_t* handle) {
   }
 }
 
+void EventLoopImpl::OnDeadline(tv_timer_t* handle) {
+  assert(handle != NULL && handle->data != NULL);
+  DeadlineEvent* ev = static_cast<DeadlineEvent*>(handle->data);
+  if (ev->queue != NULL) {
+    ev->queue->OnTimer();
+  }
+}
+
 void EventLoopImpl::OnConnectTimeout(void* args) {
   assert(args != NULL);
   SocketEvent* ev = static_cast<SocketEvent*>(args);
@@ -109,19 +126,26 @@ void EventLoopImpl::OnRequestTimeout(void* args) {
   delete request_timer;
 }
 
-EventLoopImpl::EventLoopImpl() : handle_(tv_loop_new()) {
+EventLoopImpl::EventLoopImpl()
+  : handle_(tv_loop_new()), write_buffer_pool_(new WriteBufferPool()),
+    deadline_queue_(new DeadlineQueue(handle_)) {
   assert(handle_ != NULL);
 }
 
-EventLoopImpl::EventLoopImpl(const EventLoopImpl& loop) : handle_(loop.handle_) {
+EventLoopImpl::EventLoopImpl(const EventLoopImpl& loop)
+  : handle_(loop.handle_), write_buffer_pool_(loop.write_buffer_pool_),
+    deadline_queue_(loop.deadline_queue_) {
 }
 
 EventLoopImpl& EventLoopImpl::operator=(const EventLoopImpl& loop) {
   handle_ = loop.handle_;
+  write_buffer_pool_ = loop.write_buffer_pool_;
+  deadline_queue_ = loop.deadline_queue_;
   return *this;
 }
 
 EventLoopImpl::~EventLoopImpl() {
+  deadline_queue_.reset(); // close tv_timer before deleting the loop
   tv_loop_delete(handle_);
 }
 
@@ -129,4 +153,12 @@ tv_loop_t* EventLoopImpl::GetHandle() const {
   return handle_;
 }
 
+const linear::shared_ptr<linear::WriteBufferPool>& EventLoopImpl::GetWriteBufferPool() const {
+  return write_buffer_pool_;
+}
+
+const linear::shared_ptr<linear::DeadlineQueue>& EventLoopImpl::GetDeadlineQueue() const {
+  return deadline_queue_;
+}
+
 }  // namespace linear
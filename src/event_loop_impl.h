@@ -12,9 +12,11 @@
 
 namespace linear {
 
+class DeadlineQueue;
 class ServerImpl;
 class SocketImpl;
 class TimerImpl;
+class WriteBufferPool;
 
 class EventLoopImpl {
  public:
@@ -22,6 +24,7 @@ class EventLoopImpl {
     SERVER,
     SOCKET,
     TIMER,
+    DEADLINE,
   };
   struct Event {
     Event(linear::EventLoopImpl::EventType t) : type(t) {}
@@ -43,6 +46,12 @@ class EventLoopImpl {
       : Event(linear::EventLoopImpl::TIMER), timer(t) {}
     linear::weak_ptr<linear::TimerImpl> timer;
   };
+  struct DeadlineEvent : public Event {
+    // DeadlineQueue owns the tv_timer, and clears queue before closing it
+    DeadlineEvent(linear::DeadlineQueue* q)
+      : Event(linear::EventLoopImpl::DEADLINE), queue(q) {}
+    linear::DeadlineQueue* queue;
+  };
 
  public:
   EventLoopImpl();
@@ -57,14 +66,19 @@ class EventLoopImpl {
   static void OnRead(tv_stream_t* handle, ssize_t nread, const tv_buf_t* buf);
   static void OnWrite(tv_write_t* req, int status);
   static void OnTimer(tv_timer_t* tv_timer);
+  static void OnDeadline(tv_timer_t* tv_timer);
 
   static void OnConnectTimeout(void* args);
   static void OnRequestTimeout(void* args);
 
   tv_loop_t* GetHandle() const;
+  const linear::shared_ptr<linear::WriteBufferPool>& GetWriteBufferPool() const;
+  const linear::shared_ptr<linear::DeadlineQueue>& GetDeadlineQueue() const;
 
  private:
   tv_loop_t* handle_;
+  linear::shared_ptr<linear::WriteBufferPool> write_buffer_pool_;
+  linear::shared_ptr<linear::DeadlineQueue> deadline_queue_;
 };
 
 }  // namespace linear
@@ -1,80 +1,145 @@
+#include <algorithm>
 #include <map>
 
 #include "linear/mutex.h"
 #include "linear/log.h"
 #include "linear/group.h"
 
+#include "unordered.h"
+
+#define GROUP_POOL_SHARDS (16)
+
 using namespace linear::log;
 
 namespace linear {
 
 namespace group {
 
+// groups are sharded by name, and the reverse index (socket -> group names) by socket id.
+// the socket shard is locked across updates of both, and always before a group shard,
+// so that LeaveAll never misses a group that the socket is joining at the same time.
+// members of a group are shared with readers and copied only when a reader still refers to them,
+// so that Group::Members does not copy the set.
 class Pool {
  public:
   static Pool& GetInstance() {
     static Pool pool;
     return pool;
   }
-  Pool() : mutex_() {}
+  Pool() {}
   ~Pool() {}
   std::vector<std::string> Names() {
     std::vector<std::string> keys;
-    lock_guard<linear::mutex> lock(mutex_);
-
-    std::map<std::string, std::set<linear::Socket> >::iterator it = pool_.begin();
-    while(it != pool_.end()) {
-      keys.push_back(it->first);
-      ++it;
+    for (size_t i = 0; i < GROUP_POOL_SHARDS; i++) {
+      GroupShard& shard = groups_[i];
+      lock_guard<linear::mutex> lock(shard.mutex);
+      std::map<std::string, Members>::iterator it = shard.groups.begin();
+      while(it != shard.groups.end()) {
+        keys.push_back(it->first);
+        ++it;
+      }
     }
+    std::sort(keys.begin(), keys.end());
     return keys;
   }
-  std::set<linear::Socket> Get(const std::string& name) {
-    lock_guard<linear::mutex> lock(mutex_);
-    std::map<std::string, std::set<linear::Socket> >::iterator it = pool_.find(name);
-    if (it != pool_.end()) {
+  linear::shared_ptr<const std::set<linear::Socket> > Get(const std::string& name) {
+    static const linear::shared_ptr<const std::set<linear::Socket> > empty(new std::set<linear::Socket>());
+    GroupShard& shard = GetShard(name);
+    lock_guard<linear::mutex> lock(shard.mutex);
+    std::map<std::string, Members>::iterator it = shard.groups.find(name);
+    if (it != shard.groups.end()) {
       return it->second;
     } else {
-      return std::set<linear::Socket>();
+      return empty;
     }
   }
   void Join(const std::string& name, const linear::Socket& socket) {
-    lock_guard<linear::mutex> lock(mutex_);
+    SocketShard& socket_shard = GetShard(socket);
+    lock_guard<linear::mutex> socket_lock(socket_shard.mutex);
+    socket_shard.names[socket.GetId()].insert(name);
+
+    GroupShard& group_shard = GetShard(name);
+    lock_guard<linear::mutex> group_lock(group_shard.mutex);
     LINEAR_LOG(LOG_DEBUG, "join socket(id = %d) into group_name = \"%s\"",
                socket.GetId(), name.c_str());
-    pool_[name].insert(socket);
+    Members& members = group_shard.groups[name];
+    if (!members) {
+      members = Members(new std::set<linear::Socket>());
+    } else if (members.use_count() > 1) {
+      members = Members(new std::set<linear::Socket>(*members));
+    }
+    members->insert(socket);
   }
   void Leave(const std::string& name, const linear::Socket& socket) {
-    lock_guard<linear::mutex> lock(mutex_);
     LINEAR_LOG(LOG_DEBUG, "leave socket(id = %d) from group_name = \"%s\"",
                socket.GetId(), name.c_str());
-    pool_[name].erase(socket);
+    SocketShard& socket_shard = GetShard(socket);
+    lock_guard<linear::mutex> socket_lock(socket_shard.mutex);
+    Erase(name, socket);
+
+    linear::unordered_map<int, std::set<std::string> >::iterator it = socket_shard.names.find(socket.GetId());
+    if (it != socket_shard.names.end()) {
+      it->second.erase(name);
+      if (it->second.empty()) {
+        socket_shard.names.erase(it);
+      }
+    }
   }
   void Leave(const linear::Socket& socket) {
-    lock_guard<linear::mutex> lock(mutex_);
-    std::map<std::string, std::set<linear::Socket> >::iterator pool_it = pool_.begin();
-    while (pool_it != pool_.end()) {
-      std::set<linear::Socket>& sockets = (*pool_it).second;
-      std::set<linear::Socket>::iterator socket_it = sockets.begin();
-      while (socket_it != sockets.end()) {
-        if (socket.GetId() == (*socket_it).GetId()) {
-          LINEAR_LOG(LOG_DEBUG, "leave socket(id = %d) from group_name = \"%s\"",
-                     socket.GetId(), (*pool_it).first.c_str());
-          sockets.erase(*socket_it);
-          break;
-        } else {
-          socket_it++;
-        }
-      }
-      pool_it++;
+    SocketShard& socket_shard = GetShard(socket);
+    lock_guard<linear::mutex> socket_lock(socket_shard.mutex);
+    linear::unordered_map<int, std::set<std::string> >::iterator it = socket_shard.names.find(socket.GetId());
+    if (it == socket_shard.names.end()) {
+      return;
+    }
+    const std::set<std::string>& names = it->second;
+    for (std::set<std::string>::const_iterator name_it = names.begin(); name_it != names.end(); name_it++) {
+      LINEAR_LOG(LOG_DEBUG, "leave socket(id = %d) from group_name = \"%s\"",
+                 socket.GetId(), name_it->c_str());
+      Erase(*name_it, socket);
     }
+    socket_shard.names.erase(it);
   }
 
  private:
+  typedef linear::shared_ptr<std::set<linear::Socket> > Members;
+  struct GroupShard {
+    std::map<std::string, Members> groups;
+    linear::mutex mutex;
+  };
+  struct SocketShard {
+    linear::unordered_map<int, std::set<std::string> > names; // key: socket id
+    linear::mutex mutex;
+  };
+
   Pool(const Pool& pool);
   Pool& operator=(const Group& pool);
-  std::map<std::string, std::set<linear::Socket> >pool_;
-  linear::mutex mutex_;
+
+  GroupShard& GetShard(const std::string& name) {
+    return groups_[linear::hash<std::string>()(name) % GROUP_POOL_SHARDS];
+  }
+  SocketShard& GetShard(const linear::Socket& socket) {
+    return sockets_[static_cast<size_t>(socket.GetId()) % GROUP_POOL_SHARDS];
+  }
+  void Erase(const std::string& name, const linear::Socket& socket) {
+    GroupShard& shard = GetShard(name);
+    lock_guard<linear::mutex> lock(shard.mutex);
+    std::map<std::string, Members>::iterator it = shard.groups.find(name);
+    if (it == shard.groups.end() || it->second->find(socket) == it->second->end()) {
+      return;
+    }
+    if (it->second->size() == 1) {
+      shard.groups.erase(it);
+      return;
+    }
+    if (it->second.use_count() > 1) {
+      it->second = Members(new std::set<linear::Socket>(*it->second));
+    }
+    it->second->erase(socket);
+  }
+
+  GroupShard groups_[GROUP_POOL_SHARDS];
+  SocketShard sockets_[GROUP_POOL_SHARDS];
 };
 
 } // namespace group
@@ -85,6 +150,11 @@ std::vector<std::string> Group::Names() {
 }
 
 std::set<linear::Socket> Group::Get(const std::string& name) {
+  group::Pool& pool = group::Pool::GetInstance();
+  return *pool.Get(name);
+}
+
+linear::shared_ptr<const std::set<linear::Socket> > Group::Members(const std::string& name) {
   group::Pool& pool = group::Pool::GetInstance();
   return pool.Get(name);
 }
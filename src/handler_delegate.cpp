@@ -55,9 +55,53 @@ void HandlerDelegate::Release(const shared_ptr<SocketImpl>& socket) {
   return pool_.Remove(socket);
 }
 
+std::vector<Socket> HandlerDelegate::GetSockets() {
+  return pool_.GetAll();
+}
+
+void HandlerDelegate::SetDispatcher(const shared_ptr<DispatcherImpl>& dispatcher) {
+  dispatcher_ = dispatcher;
+}
+
 void HandlerDelegate::OnConnect(const shared_ptr<SocketImpl>& socket) {
+  socket->RecordConnectTime();
+  if (_Post(DispatcherImpl::ON_CONNECT, socket)) {
+    return;
+  }
+  CallOnConnect(handler_, socket);
+}
+
+void HandlerDelegate::OnDisconnect(const shared_ptr<SocketImpl>& socket, const Error& error) {
+  if (_Post(DispatcherImpl::ON_DISCONNECT, socket, NULL, error)) {
+    return;
+  }
+  CallOnDisconnect(handler_, socket, error);
+}
+
+void HandlerDelegate::OnMessage(const shared_ptr<SocketImpl>& socket, const Message& message) {
+  if (_Post(DispatcherImpl::ON_MESSAGE, socket, &message)) {
+    return;
+  }
+  CallOnMessage(handler_, socket, message);
+}
+
+void HandlerDelegate::OnError(const shared_ptr<SocketImpl>& socket, const Message& message, const Error& error) {
+  if (_Post(DispatcherImpl::ON_ERROR, socket, &message, error)) {
+    return;
+  }
+  CallOnError(handler_, socket, message, error);
+}
+
+void HandlerDelegate::OnWritable(const shared_ptr<SocketImpl>& socket) {
+  if (_Post(DispatcherImpl::ON_WRITABLE, socket)) {
+    return;
+  }
+  CallOnWritable(handler_, socket);
+}
+
+void HandlerDelegate::CallOnConnect(const weak_ptr<Handler>& handler_ref, const shared_ptr<SocketImpl>& socket) {
   try {
-    if (shared_ptr<Handler> handler = handler_.lock()) {
+    if (shared_ptr<Handler> handler = handler_ref.lock()) {
       handler->OnConnect(Socket(socket));
     }
   } catch(...) {
@@ -65,9 +109,10 @@ void HandlerDelegate::OnConnect(const shared_ptr<SocketImpl>& socket) {
   }
 }
 
-void HandlerDelegate::OnDisconnect(const shared_ptr<SocketImpl>& socket, const Error& error) {
+void HandlerDelegate::CallOnDisconnect(const weak_ptr<Handler>& handler_ref, const shared_ptr<SocketImpl>& socket,
+                                       const Error& error) {
   try {
-    if (shared_ptr<Handler> handler = handler_.lock()) {
+    if (shared_ptr<Handler> handler = handler_ref.lock()) {
       handler->OnDisconnect(Socket(socket), error);
     }
   } catch(...) {
@@ -75,7 +120,8 @@ void HandlerDelegate::OnDisconnect(const shared_ptr<SocketImpl>& socket, const E
   }
 }
 
-void HandlerDelegate::OnMessage(const shared_ptr<SocketImpl>& socket, const Message& message) {
+void HandlerDelegate::CallOnMessage(const weak_ptr<Handler>& handler_ref, const shared_ptr<SocketImpl>& socket,
+                                    const Message& message) {
   if (message.type == RESPONSE) {
     Response response = message.as<Response>();
     const Request& request = response.request;
@@ -87,7 +133,7 @@ void HandlerDelegate::OnMessage(const shared_ptr<SocketImpl>& socket, const Mess
       }
     } else {
       try {
-        if (shared_ptr<Handler> handler = handler_.lock()) {
+        if (shared_ptr<Handler> handler = handler_ref.lock()) {
           handler->OnMessage(Socket(socket), message);
         }
       } catch(...) {
@@ -96,7 +142,7 @@ void HandlerDelegate::OnMessage(const shared_ptr<SocketImpl>& socket, const Mess
     }
   } else {
     try {
-      if (shared_ptr<Handler> handler = handler_.lock()) {
+      if (shared_ptr<Handler> handler = handler_ref.lock()) {
         handler->OnMessage(Socket(socket), message);
       }
     } catch(...) {
@@ -105,7 +151,8 @@ void HandlerDelegate::OnMessage(const shared_ptr<SocketImpl>& socket, const Mess
   }
 }
 
-void HandlerDelegate::OnError(const shared_ptr<SocketImpl>& socket, const Message& message, const Error& error) {
+void HandlerDelegate::CallOnError(const weak_ptr<Handler>& handler_ref, const shared_ptr<SocketImpl>& socket,
+                                  const Message& message, const Error& error) {
   if (message.type == REQUEST) {
     Request request = message.as<Request>();
     if (request.HasErrorCallback()) {
@@ -116,7 +163,7 @@ void HandlerDelegate::OnError(const shared_ptr<SocketImpl>& socket, const Messag
       }
     } else {
       try {
-        if (shared_ptr<Handler> handler = handler_.lock()) {
+        if (shared_ptr<Handler> handler = handler_ref.lock()) {
           handler->OnError(Socket(socket), message, error);
         }
       } catch(...) {
@@ -125,7 +172,7 @@ void HandlerDelegate::OnError(const shared_ptr<SocketImpl>& socket, const Messag
     }
   } else {
     try {
-      if (shared_ptr<Handler> handler = handler_.lock()) {
+      if (shared_ptr<Handler> handler = handler_ref.lock()) {
         handler->OnError(Socket(socket), message, error);
       }
     } catch(...) {
@@ -134,4 +181,52 @@ void HandlerDelegate::OnError(const shared_ptr<SocketImpl>& socket, const Messag
   }
 }
 
+void HandlerDelegate::CallOnWritable(const weak_ptr<Handler>& handler_ref, const shared_ptr<SocketImpl>& socket) {
+  try {
+    if (shared_ptr<Handler> handler = handler_ref.lock()) {
+      handler->OnWritable(Socket(socket));
+    }
+  } catch(...) {
+    LINEAR_LOG(LOG_WARN, "something wrong at Handler::OnWritable");
+  }
+}
+
+// queue the event to the dispatcher with a copy of the message.
+// return false only when no dispatcher is set, and then the handler is called in this thread.
+// an event that fails to be queued is dropped, because calling the handler here would
+// overtake the events of the socket queued before.
+bool HandlerDelegate::_Post(DispatcherImpl::EventType type, const shared_ptr<SocketImpl>& socket,
+                            const Message* message, const Error& error) {
+  if (!dispatcher_) {
+    return false;
+  }
+  Error result(LNR_ENOMEM);
+  try {
+    DispatcherImpl::Event event(type, handler_, socket);
+    event.error = error;
+    if (message != NULL) {
+      switch(message->type) {
+      case REQUEST:
+        event.message = shared_ptr<Message>(new Request(message->as<Request>()));
+        break;
+      case RESPONSE:
+        event.message = shared_ptr<Message>(new Response(message->as<Response>()));
+        break;
+      case NOTIFY:
+        event.message = shared_ptr<Message>(new Notify(message->as<Notify>()));
+        break;
+      default:
+        LINEAR_LOG(LOG_ERR, "invalid type of message: %d", message->type);
+        return true;
+      }
+    }
+    result = dispatcher_->Post(event);
+  } catch(...) {
+  }
+  if (result != Error(LNR_OK)) {
+    LINEAR_LOG(LOG_ERR, "drop event of socket(id = %d): %s", socket->GetId(), result.Message().c_str());
+  }
+  return true;
+}
+
 } // namespace linear
@@ -4,6 +4,7 @@
 #include "linear/event_loop.h"
 #include "linear/handler.h"
 
+#include "dispatcher_impl.h"
 #include "event_loop_impl.h"
 #include "socket_pool.h"
 
@@ -19,6 +20,10 @@ class HandlerDelegate {
   void SetMaxLimit(size_t max_limit);
   virtual linear::Error Retain(const linear::shared_ptr<linear::SocketImpl>& socket);
   virtual void Release(const linear::shared_ptr<linear::SocketImpl>& socket);
+  std::vector<linear::Socket> GetSockets();
+  // handlers are called in workers of the dispatcher if set.
+  // set before the server starts or sockets connect.
+  void SetDispatcher(const linear::shared_ptr<linear::DispatcherImpl>& dispatcher);
 
   virtual void OnConnect(const linear::shared_ptr<linear::SocketImpl>& socket);
   virtual void OnDisconnect(const linear::shared_ptr<linear::SocketImpl>& socket,
@@ -28,11 +33,34 @@ class HandlerDelegate {
   virtual void OnError(const linear::shared_ptr<linear::SocketImpl>& socket,
                        const linear::Message& message,
                        const linear::Error& error);
+  virtual void OnWritable(const linear::shared_ptr<linear::SocketImpl>& socket);
+
+  // call handlers (or closures of requests) in the current thread
+  static void CallOnConnect(const linear::weak_ptr<linear::Handler>& handler,
+                            const linear::shared_ptr<linear::SocketImpl>& socket);
+  static void CallOnDisconnect(const linear::weak_ptr<linear::Handler>& handler,
+                               const linear::shared_ptr<linear::SocketImpl>& socket,
+                               const linear::Error& error);
+  static void CallOnMessage(const linear::weak_ptr<linear::Handler>& handler,
+                            const linear::shared_ptr<linear::SocketImpl>& socket,
+                            const linear::Message& message);
+  static void CallOnError(const linear::weak_ptr<linear::Handler>& handler,
+                          const linear::shared_ptr<linear::SocketImpl>& socket,
+                          const linear::Message& message,
+                          const linear::Error& error);
+  static void CallOnWritable(const linear::weak_ptr<linear::Handler>& handler,
+                             const linear::shared_ptr<linear::SocketImpl>& socket);
 
  protected:
   linear::shared_ptr<linear::EventLoopImpl> loop_;
   linear::weak_ptr<linear::Handler> handler_;
   linear::SocketPool pool_;
+
+ private:
+  bool _Post(linear::DispatcherImpl::EventType type, const linear::shared_ptr<linear::SocketImpl>& socket,
+             const linear::Message* message = NULL, const linear::Error& error = linear::Error(linear::LNR_OK));
+
+  linear::shared_ptr<linear::DispatcherImpl> dispatcher_;
 };
 
 }  // namespace linear
@@ -3,6 +3,8 @@
 
 #include "log_stderr.h"
 #include "log_function.h"
+#include "log_async.h"
+#include "log_binary.h"
 
 #ifdef _WIN32
 # include <stdlib.h>
@@ -20,6 +22,8 @@ static Level g_level = LOG_OFF;
 static bool g_log_stderr = false;
 static bool g_log_file = false;
 static bool g_log_function = false;
+static bool g_log_async = false;
+static bool g_log_binary = false;
 
 static LogStderr& GetLogStderr() {
   static LogStderr s_stderr;
@@ -33,6 +37,14 @@ static LogFunction& GetLogFunction() {
   static LogFunction s_function;
   return s_function;
 }
+static LogBinary& GetLogBinary() {
+  static LogBinary s_binary;
+  return s_binary;
+}
+static LogAsync& GetLogAsync() {
+  static LogAsync s_async;
+  return s_async;
+}
 
 /* functions */
 Level GetLevel() {
@@ -53,11 +65,29 @@ bool EnableFile(const std::string& filename) {
   return g_log_file;
 }
 
+bool EnableFile(const std::string& filename, size_t max_size, unsigned int interval, size_t retention) {
+  g_log_file = GetLogFile().Enable(filename, max_size, interval, retention);
+  return g_log_file;
+}
+
+bool EnableBinaryFile(const std::string& filename) {
+  g_log_binary = GetLogBinary().Enable(filename);
+  return g_log_binary;
+}
+
 bool EnableCallback(LogCallback callback) {
   g_log_function = GetLogFunction().Enable(callback);
   return g_log_function;
 }
 
+bool EnableAsync(size_t capacity, OverflowPolicy policy) {
+  std::vector<LogFile*> sinks;
+  sinks.push_back(&GetLogStderr());
+  sinks.push_back(&GetLogFile());
+  g_log_async = GetLogAsync().Enable(capacity, policy, sinks);
+  return g_log_async;
+}
+
 void DisableStderr() {
   if (g_log_stderr) {
     GetLogStderr().Disable();
@@ -72,6 +102,13 @@ void DisableFile() {
   }
 }
 
+void DisableBinaryFile() {
+  if (g_log_binary) {
+    GetLogBinary().Disable();
+    g_log_binary = false;
+  }
+}
+
 void DisableCallback() {
   if (g_log_function) {
     GetLogFunction().Disable();
@@ -79,6 +116,17 @@ void DisableCallback() {
   }
 }
 
+void DisableAsync() {
+  if (g_log_async) {
+    g_log_async = false;
+    GetLogAsync().Disable();
+  }
+}
+
+size_t GetDroppedCount() {
+  return GetLogAsync().GetDroppedCount();
+}
+
 void Colorize(bool flag) {
   if (g_log_stderr) {
     GetLogStderr().Colorize(flag);
@@ -86,13 +134,26 @@ void Colorize(bool flag) {
 }
 
 bool DoPrint(linear::log::Level level) {
-  return (level <= g_level && (g_log_stderr || g_log_file || g_log_function));
+  return (level <= g_level && (g_log_stderr || g_log_file || g_log_function || g_log_binary));
+}
+
+bool DoFormat() {
+  return (g_log_stderr || g_log_file || g_log_function);
 }
 
 void Print(bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* format, ...) {
   va_list args;
-  char buffer[LOG_BUFSIZ];
 
+  if (g_log_binary) {
+    va_start(args, format);
+    GetLogBinary().Write(debug, level, file, line, func, format, args);
+    va_end(args);
+  }
+  if (!DoFormat()) {
+    return;
+  }
+
+  char buffer[LOG_BUFSIZ];
   va_start(args, format);
 #ifdef _WIN32
   vsnprintf_s(buffer, LOG_BUFSIZ, _TRUNCATE, format, args);
@@ -101,11 +162,15 @@ void Print(bool debug, linear::log::Level level, const char* file, int line, con
 #endif
   va_end(args);
 
-  if (g_log_stderr) {
-    GetLogStderr().Write(debug, level, file, line, func, buffer);
-  }
-  if (g_log_file) {
-    GetLogFile().Write(debug, level, file, line, func, buffer);
+  bool queued = (g_log_async && (g_log_stderr || g_log_file) &&
+                 GetLogAsync().Push(debug, level, file, line, func, buffer));
+  if (!queued) {
+    if (g_log_stderr) {
+      GetLogStderr().Write(debug, level, file, line, func, buffer);
+    }
+    if (g_log_file) {
+      GetLogFile().Write(debug, level, file, line, func, buffer);
+    }
   }
   if (g_log_function) {
     GetLogFunction().Write(debug, level, file, line, func, buffer);
@@ -113,21 +178,31 @@ void Print(bool debug, linear::log::Level level, const char* file, int line, con
 }
 
 /* Log class methods */
-std::string Log::GetDateTime() {
+void Log::GetTime(Time* at) {
+#ifdef _WIN32
+  GetLocalTime(at);
+#else
+  if (gettimeofday(at, 0) != 0) {
+    at->tv_sec = static_cast<time_t>(-1);
+    at->tv_usec = 0;
+  }
+#endif
+}
+
+std::string Log::GetDateTime(const Time& at) {
   char datetime_str[32];
 
 #ifdef _WIN32
-  SYSTEMTIME st;
-  GetLocalTime(&st);
+  const SYSTEMTIME& st = at;
   _snprintf_s(datetime_str, sizeof(datetime_str), _TRUNCATE,
               "%d-%02d-%02d %02d:%02d:%02d.%03d",
               st.wYear, st.wMonth, st.wDay,
               st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
 #else
   struct tm ts;
-  struct timeval now;
+  const struct timeval& now = at;
   struct tm* ret = NULL;
-  if (gettimeofday(&now, 0) == 0) {
+  if (now.tv_sec != static_cast<time_t>(-1)) {
     ret = localtime_r(&now.tv_sec, &ts);
   }
   if (ret == NULL) {
@@ -1,6 +1,12 @@
 #ifndef	LINEAR_LOG_INTERNAL_H_
 #define	LINEAR_LOG_INTERNAL_H_
 
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <sys/time.h>
+#endif
+
 #include "linear/log.h"
 #include "linear/mutex.h"
 
@@ -12,6 +18,14 @@ namespace log {
 
 class Log {
  public:
+#ifdef _WIN32
+  typedef SYSTEMTIME Time;
+#else
+  typedef struct timeval Time;
+#endif
+  // take the time when a log is printed, it may be formatted later in another thread
+  static void GetTime(Time* at);
+
   virtual void Write(bool debug, Level level, const char* fname, int line, const char* func, const char* message) = 0;
 
  protected:
@@ -20,7 +34,7 @@ class Log {
   Log& operator=(const Log& rhs);
   virtual ~Log() {}
   virtual bool Available() = 0;
-  std::string GetDateTime();
+  std::string GetDateTime(const Time& at);
 
   linear::mutex mutex_;
 };
@@ -0,0 +1,139 @@
+#include "log_async.h"
+
+namespace linear {
+
+namespace log {
+
+LogAsync::LogAsync()
+  : head_(0), count_(0), policy_(LOG_OVERFLOW_DROP), dropped_(0), running_(false) {
+}
+
+LogAsync::~LogAsync() {
+  Disable();
+}
+
+bool LogAsync::Enable(size_t capacity, OverflowPolicy policy, const std::vector<LogFile*>& sinks) {
+  Disable();
+  if (capacity == 0) {
+    return false;
+  }
+  linear::lock_guard<linear::mutex> lock(mutex_);
+  try {
+    std::vector<Record>(capacity).swap(ring_);
+    sinks_ = sinks;
+  } catch(...) {
+    return false;
+  }
+  head_ = 0;
+  count_ = 0;
+  policy_ = policy;
+  running_ = true;
+  if (uv_thread_create(&thread_, LogAsync::Run, this) != 0) {
+    running_ = false;
+    std::vector<Record>().swap(ring_);
+    return false;
+  }
+  return true;
+}
+
+// stop the writer thread after it writes all queued logs
+void LogAsync::Disable() {
+  linear::unique_lock<linear::mutex> lock(mutex_);
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  not_empty_.notify_all();
+  not_full_.notify_all();
+  lock.unlock();
+  uv_thread_join(&thread_);
+  lock.lock();
+  std::vector<Record>().swap(ring_);
+  sinks_.clear();
+}
+
+bool LogAsync::Push(bool debug, Level level, const char* file, int line, const char* func, const char* message) {
+  Log::Time now;
+  Log::GetTime(&now);
+  linear::unique_lock<linear::mutex> lock(mutex_);
+  while (running_ && count_ == ring_.size()) {
+    if (policy_ == LOG_OVERFLOW_DROP) {
+      dropped_++;
+      return true;
+    }
+    not_full_.wait(lock);
+  }
+  if (!running_) {
+    return false;
+  }
+  Record& record = ring_[(head_ + count_) % ring_.size()];
+  try {
+    record.message.assign(message); // reuses the capacity of the slot
+  } catch(...) {
+    dropped_++;
+    return true;
+  }
+  record.at = now;
+  record.debug = debug;
+  record.level = level;
+  record.file = file;
+  record.line = line;
+  record.func = func;
+  count_++;
+  if (count_ == 1) {
+    not_empty_.notify_one();
+  }
+  return true;
+}
+
+size_t LogAsync::GetDroppedCount() {
+  linear::lock_guard<linear::mutex> lock(mutex_);
+  return dropped_;
+}
+
+void LogAsync::Run(void* arg) {
+  static_cast<LogAsync*>(arg)->_Run();
+}
+
+void LogAsync::_Run() {
+  linear::unique_lock<linear::mutex> lock(mutex_);
+  std::vector<Record> batch(ring_.size());
+  while (true) {
+    while (running_ && count_ == 0) {
+      not_empty_.wait(lock);
+    }
+    if (count_ == 0) {
+      break; // disabled and all logs are written
+    }
+    // take all queued logs, and swap the strings so that the slots keep their capacity
+    size_t n = count_;
+    for (size_t i = 0; i < n; i++) {
+      Record& record = ring_[(head_ + i) % ring_.size()];
+      batch[i].at = record.at;
+      batch[i].debug = record.debug;
+      batch[i].level = record.level;
+      batch[i].file = record.file;
+      batch[i].line = record.line;
+      batch[i].func = record.func;
+      batch[i].message.swap(record.message);
+    }
+    head_ = (head_ + n) % ring_.size();
+    count_ = 0;
+    not_full_.notify_all();
+    lock.unlock();
+
+    for (std::vector<LogFile*>::iterator it = sinks_.begin(); it != sinks_.end(); it++) {
+      for (size_t i = 0; i < n; i++) {
+        (*it)->Append(batch[i].at, batch[i].debug, batch[i].level, batch[i].file, batch[i].line,
+                      batch[i].func, batch[i].message.c_str());
+      }
+      (*it)->Flush();
+    }
+
+    lock.lock();
+  }
+}
+
+}  // namespace log
+
+}  // namespace linear
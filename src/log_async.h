@@ -0,0 +1,62 @@
+#ifndef	LINEAR_LOG_ASYNC_H_
+#define	LINEAR_LOG_ASYNC_H_
+
+#include <vector>
+
+#include "uv.h"
+
+#include "linear/condition_variable.h"
+
+#include "log_file.h"
+
+namespace linear {
+
+namespace log {
+
+// queue logs into a bounded ring buffer, and write them to LogFile/LogStderr in a background thread.
+// the writer thread takes all queued logs at once, writes them and flushes once per batch.
+class LogAsync {
+ public:
+  LogAsync();
+  ~LogAsync();
+  bool Enable(size_t capacity, linear::log::OverflowPolicy policy, const std::vector<linear::log::LogFile*>& sinks);
+  void Disable();
+  // return false when not enabled, and then the caller should write the log by itself
+  bool Push(bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* message);
+  size_t GetDroppedCount();
+
+ private:
+  struct Record {
+    Record() : at(), debug(false), level(LOG_OFF), file(NULL), line(0), func(NULL), message() {}
+    linear::log::Log::Time at; // when the log is pushed, not when it is written
+    bool debug;
+    linear::log::Level level;
+    const char* file; // __FILE__
+    int line;
+    const char* func; // __PRETTY_FUNCTION__
+    std::string message;
+  };
+
+  LogAsync(const LogAsync& rhs);
+  LogAsync& operator=(const LogAsync& rhs);
+  static void Run(void* arg);
+  void _Run();
+
+  std::vector<Record> ring_;
+  size_t head_;
+  size_t count_;
+  linear::log::OverflowPolicy policy_;
+  size_t dropped_;
+  bool running_;
+  std::vector<linear::log::LogFile*> sinks_;
+  uv_thread_t thread_;
+  linear::mutex mutex_;
+  linear::condition_variable not_empty_;
+  linear::condition_variable not_full_;
+};
+
+}  // namespace log
+
+}  // namespace linear
+
+#endif	// LINEAR_LOG_ASYNC_H_
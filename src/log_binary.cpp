@@ -0,0 +1,288 @@
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "uv.h"
+
+#include "log_binary.h"
+
+#ifndef _WIN32
+# include <sys/time.h>
+#endif
+
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_COARSE)
+# define LINEAR_LOG_BINARY_COARSE_CLOCK
+#endif
+
+namespace linear {
+
+namespace log {
+
+// fixed size buffer of a record, so that writing a log does not allocate memory.
+// strings that do not fit are truncated.
+struct RecordBuffer {
+  RecordBuffer() : size(0) {}
+  char data[LOG_BUFSIZ];
+  size_t size;
+};
+
+static bool Put(RecordBuffer& buffer, const void* data, size_t size) {
+  if (size > sizeof(buffer.data) - buffer.size) {
+    return false;
+  }
+  memcpy(buffer.data + buffer.size, data, size);
+  buffer.size += size;
+  return true;
+}
+
+template <typename T>
+static bool Put(RecordBuffer& buffer, T value) {
+  return Put(buffer, &value, sizeof(value));
+}
+
+static bool PutBytes(RecordBuffer& buffer, const char* data, size_t length) {
+  size_t room = sizeof(buffer.data) - buffer.size;
+  if (room < sizeof(uint32_t)) {
+    return false;
+  }
+  uint32_t size = static_cast<uint32_t>(std::min(length, room - sizeof(uint32_t)));
+  Put(buffer, size);
+  return Put(buffer, data, size);
+}
+
+static bool PutString(RecordBuffer& buffer, const char* str) {
+  if (str == NULL) {
+    str = "(null)";
+  }
+  return PutBytes(buffer, str, strlen(str));
+}
+
+static bool PutArg(RecordBuffer& buffer, char type, int64_t value) {
+  return Put(buffer, static_cast<uint8_t>(type)) && Put(buffer, value);
+}
+
+static bool PutArg(RecordBuffer& buffer, char type, uint64_t value) {
+  return Put(buffer, static_cast<uint8_t>(type)) && Put(buffer, value);
+}
+
+static bool PutArg(RecordBuffer& buffer, double value) {
+  return Put(buffer, static_cast<uint8_t>(LOG_BINARY_DOUBLE)) && Put(buffer, value);
+}
+
+static bool PutArg(RecordBuffer& buffer, const char* value) {
+  if (value != NULL && strncmp(value, LINEAR_LOG_BLOB_MARKER, LINEAR_LOG_BLOB_MARKER_SIZE) == 0) {
+    uint32_t size;
+    memcpy(&size, value + LINEAR_LOG_BLOB_MARKER_SIZE, sizeof(size));
+    return (Put(buffer, static_cast<uint8_t>(LOG_BINARY_BLOB)) &&
+            PutBytes(buffer, value + LINEAR_LOG_BLOB_MARKER_SIZE + sizeof(size), size));
+  }
+  return Put(buffer, static_cast<uint8_t>(LOG_BINARY_STRING)) && PutString(buffer, value);
+}
+
+static bool IsLength(const FormatSpec& spec, const char* length) {
+  size_t n = ((spec.conversion == '\0') ? spec.end : spec.end - 1) - spec.length;
+  return (n == strlen(length) && strncmp(spec.length, length, n) == 0);
+}
+
+static uint64_t GetWallClock() {
+#ifdef _WIN32
+  return static_cast<uint64_t>(time(NULL)) * 1000000;
+#else
+  struct timeval now;
+  if (gettimeofday(&now, 0) != 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(now.tv_sec) * 1000000 + static_cast<uint64_t>(now.tv_usec);
+#endif
+}
+
+#ifdef LINEAR_LOG_BINARY_COARSE_CLOCK
+// the coarse clock counts from the same origin as CLOCK_MONOTONIC, that uv_hrtime() reads.
+static bool UseCoarseClock() {
+  struct timespec res;
+  return (clock_getres(CLOCK_MONOTONIC_COARSE, &res) == 0 && res.tv_sec == 0 && res.tv_nsec <= 1000000);
+}
+#endif
+
+// read a coarse clock instead of uv_hrtime() when it is as precise as the text log (msec)
+static uint64_t GetMonotonicClock() {
+#ifdef LINEAR_LOG_BINARY_COARSE_CLOCK
+  static const bool coarse = UseCoarseClock();
+  struct timespec now;
+  if (coarse && clock_gettime(CLOCK_MONOTONIC_COARSE, &now) == 0) {
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+  }
+#endif
+  return static_cast<uint64_t>(uv_hrtime());
+}
+
+LogBinary::~LogBinary() {
+  Disable();
+}
+
+bool LogBinary::Available() {
+  linear::lock_guard<linear::mutex> lock(mutex_);
+  return (fp_ != NULL);
+}
+
+bool LogBinary::Enable(const std::string& filename) {
+  linear::lock_guard<linear::mutex> lock(mutex_);
+  if (fp_ != NULL) {
+    fclose(fp_);
+  }
+  ids_.clear();
+  next_id_ = 0;
+
+#ifdef _WIN32
+  fp_ = _fsopen(filename.c_str(), "wb", _SH_DENYWR);
+#else
+  fp_ = fopen(filename.c_str(), "wb");
+#endif
+
+  if (fp_ == NULL) {
+    return false;
+  }
+  RecordBuffer header;
+  Put(header, static_cast<uint32_t>(LOG_BINARY_MAGIC));
+  Put(header, static_cast<uint32_t>(LOG_BINARY_VERSION));
+  Put(header, GetWallClock());
+  Put(header, static_cast<uint64_t>(uv_hrtime()));
+  if (fwrite(header.data, 1, header.size, fp_) != header.size) {
+    fclose(fp_);
+    fp_ = NULL;
+    return false;
+  }
+  return true;
+}
+
+void LogBinary::Disable() {
+  linear::lock_guard<linear::mutex> lock(mutex_);
+  if (fp_ != NULL) {
+    fclose(fp_);
+    fp_ = NULL;
+  }
+  ids_.clear();
+}
+
+// record the raw arguments instead of formatting them.
+// records are buffered by stdio, and flushed only for LOG_WARN and LOG_ERR.
+void LogBinary::Write(bool debug, Level level, const char* file, int line, const char* func,
+                      const char* format, va_list args) {
+  RecordBuffer record;
+  Put(record, static_cast<uint8_t>(LOG_BINARY_RECORD));
+  Put(record, static_cast<uint32_t>(0)); // id is filled below
+  Put(record, static_cast<uint8_t>(level));
+  Put(record, static_cast<uint8_t>(debug ? 1 : 0));
+  Put(record, GetMonotonicClock());
+  size_t size_offset = record.size;
+  Put(record, static_cast<uint32_t>(0)); // size of args is filled below
+  size_t args_offset = record.size;
+
+  // stop recording args when the record is full
+  bool ok = true;
+  FormatSpec spec;
+  const char* p = format;
+  while (ok && NextFormatSpec(p, &spec)) {
+    p = spec.end;
+    for (int i = 0; ok && i < spec.stars; i++) {
+      ok = PutArg(record, LOG_BINARY_INT, static_cast<int64_t>(va_arg(args, int)));
+    }
+    if (!ok) {
+      break;
+    }
+    switch(spec.type) {
+    case LOG_BINARY_INT:
+      if (IsLength(spec, "l")) {
+        ok = PutArg(record, LOG_BINARY_INT, static_cast<int64_t>(va_arg(args, long)));
+      } else if (IsLength(spec, "ll") || IsLength(spec, "q")) {
+        ok = PutArg(record, LOG_BINARY_INT, static_cast<int64_t>(va_arg(args, long long)));
+      } else if (IsLength(spec, "z")) {
+        ok = PutArg(record, LOG_BINARY_INT, static_cast<int64_t>(va_arg(args, size_t)));
+      } else if (IsLength(spec, "j")) {
+        ok = PutArg(record, LOG_BINARY_INT, static_cast<int64_t>(va_arg(args, intmax_t)));
+      } else if (IsLength(spec, "t")) {
+        ok = PutArg(record, LOG_BINARY_INT, static_cast<int64_t>(va_arg(args, ptrdiff_t)));
+      } else {
+        ok = PutArg(record, LOG_BINARY_INT, static_cast<int64_t>(va_arg(args, int)));
+      }
+      break;
+    case LOG_BINARY_UINT:
+      if (IsLength(spec, "l")) {
+        ok = PutArg(record, LOG_BINARY_UINT, static_cast<uint64_t>(va_arg(args, unsigned long)));
+      } else if (IsLength(spec, "ll") || IsLength(spec, "q")) {
+        ok = PutArg(record, LOG_BINARY_UINT, static_cast<uint64_t>(va_arg(args, unsigned long long)));
+      } else if (IsLength(spec, "z")) {
+        ok = PutArg(record, LOG_BINARY_UINT, static_cast<uint64_t>(va_arg(args, size_t)));
+      } else if (IsLength(spec, "j")) {
+        ok = PutArg(record, LOG_BINARY_UINT, static_cast<uint64_t>(va_arg(args, uintmax_t)));
+      } else if (IsLength(spec, "t")) {
+        ok = PutArg(record, LOG_BINARY_UINT, static_cast<uint64_t>(va_arg(args, ptrdiff_t)));
+      } else {
+        ok = PutArg(record, LOG_BINARY_UINT, static_cast<uint64_t>(va_arg(args, unsigned int)));
+      }
+      break;
+    case LOG_BINARY_DOUBLE:
+      if (IsLength(spec, "L")) {
+        ok = PutArg(record, static_cast<double>(va_arg(args, long double)));
+      } else {
+        ok = PutArg(record, va_arg(args, double));
+      }
+      break;
+    case LOG_BINARY_POINTER:
+      ok = PutArg(record, LOG_BINARY_POINTER, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(va_arg(args, void*))));
+      break;
+    case LOG_BINARY_STRING:
+      if (spec.wide) {
+        (void) va_arg(args, void*); // wide strings are not supported
+        ok = PutArg(record, "(wide string)");
+      } else {
+        ok = PutArg(record, va_arg(args, const char*));
+      }
+      break;
+    default:
+      if (spec.conversion == 'n') {
+        (void) va_arg(args, void*);
+      }
+      break;
+    }
+  }
+  uint32_t args_size = static_cast<uint32_t>(record.size - args_offset);
+  memcpy(record.data + size_offset, &args_size, sizeof(args_size));
+
+  linear::lock_guard<linear::mutex> lock(mutex_);
+  if (fp_ == NULL) {
+    return;
+  }
+  uint32_t id = _GetId(file, line, func, format);
+  memcpy(record.data + 1, &id, sizeof(id));
+  fwrite(record.data, 1, record.size, fp_);
+  if (level <= LOG_WARN) {
+    fflush(fp_);
+  }
+}
+
+// write the format record at the first time of each call site
+uint32_t LogBinary::_GetId(const char* file, int line, const char* func, const char* format) {
+  Site site(format, std::make_pair(file, line));
+  std::map<Site, uint32_t>::iterator it = ids_.find(site);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+  uint32_t id = next_id_++;
+  RecordBuffer record;
+  Put(record, static_cast<uint8_t>(LOG_BINARY_FORMAT));
+  Put(record, id);
+  Put(record, static_cast<int32_t>(line));
+  PutString(record, file);
+  PutString(record, func);
+  PutString(record, format);
+  fwrite(record.data, 1, record.size, fp_);
+  ids_.insert(std::make_pair(site, id));
+  return id;
+}
+
+}  // namespace log
+
+}  // namespace linear
@@ -0,0 +1,152 @@
+#ifndef	LINEAR_LOG_BINARY_H_
+#define	LINEAR_LOG_BINARY_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+
+#include "log.h"
+
+/*
+ * binary log format (native byte order)
+ *
+ * header: uint32_t magic, uint32_t version,
+ *         uint64_t wall clock (usec since epoch) and uint64_t monotonic clock (nsec) at open
+ * format: uint8_t 'F', uint32_t id, int32_t line, string file, string func, string format
+ *         written once for each call site, before the first record that refers to it
+ * record: uint8_t 'R', uint32_t id, uint8_t level, uint8_t debug, uint64_t monotonic clock (nsec),
+ *         uint32_t size of args, args
+ * arg:    uint8_t type, value (int64_t, uint64_t, double, uint64_t pointer, string or blob)
+ * string: uint32_t length, bytes (not terminated)
+ * blob:   uint32_t length, msgpack bytes
+ *
+ * args are the raw arguments of the printf format, in the order of the format.
+ * a "%s" argument made by LINEAR_LOG_PRINTABLE_STRING is recorded as a blob,
+ * that is truncated as well as strings when it does not fit.
+ * tools/linear_logdecode renders them as text.
+ */
+#define LOG_BINARY_MAGIC   (0x4c4e5242) // "LNRB"
+#define LOG_BINARY_VERSION (1)
+
+#define LOG_BINARY_FORMAT  ('F')
+#define LOG_BINARY_RECORD  ('R')
+
+#define LOG_BINARY_INT     ('i')
+#define LOG_BINARY_UINT    ('u')
+#define LOG_BINARY_DOUBLE  ('d')
+#define LOG_BINARY_POINTER ('p')
+#define LOG_BINARY_STRING  ('s')
+#define LOG_BINARY_BLOB    ('b')
+
+namespace linear {
+
+namespace log {
+
+// a conversion specification of printf format.
+// spec points "%", length points the length modifier (or conversion when none),
+// and end points the next of conversion.
+struct FormatSpec {
+  const char* spec;
+  const char* length;
+  const char* end;
+  int stars;       // number of '*' in width and precision
+  char conversion; // 0 when the format ends with an incomplete specification
+  char type;       // LOG_BINARY_XXX of the argument, 0 when no argument
+  bool wide;       // l, ll, z, j, t or L modifier
+};
+
+// find the next conversion specification from p.
+// return false when no more specification.
+inline bool NextFormatSpec(const char* p, FormatSpec* spec) {
+  while (*p != '\0') {
+    if (*p != '%') {
+      p++;
+      continue;
+    }
+    spec->spec = p++;
+    spec->stars = 0;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+      p++;
+    }
+    if (*p == '*') {
+      spec->stars++;
+      p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+      p++;
+    }
+    if (*p == '.') {
+      p++;
+      if (*p == '*') {
+        spec->stars++;
+        p++;
+      }
+      while (*p >= '0' && *p <= '9') {
+        p++;
+      }
+    }
+    spec->length = p;
+    while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 'j' || *p == 't' || *p == 'L' || *p == 'q') {
+      p++;
+    }
+    spec->wide = (p != spec->length && *spec->length != 'h');
+    spec->conversion = *p;
+    spec->end = (*p == '\0') ? p : p + 1;
+    switch(*p) {
+    case 'd': case 'i': case 'c':
+      spec->type = LOG_BINARY_INT;
+      break;
+    case 'u': case 'o': case 'x': case 'X':
+      spec->type = LOG_BINARY_UINT;
+      break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+      spec->type = LOG_BINARY_DOUBLE;
+      break;
+    case 'p':
+      spec->type = LOG_BINARY_POINTER;
+      break;
+    case 's':
+      spec->type = LOG_BINARY_STRING;
+      break;
+    case 'n': // the argument is consumed, but not recorded
+    case '%':
+    default:
+      spec->type = 0;
+      break;
+    }
+    return true;
+  }
+  return false;
+}
+
+class LogBinary {
+ public:
+  LogBinary() : fp_(NULL), next_id_(0) {}
+  ~LogBinary();
+  bool Available();
+  bool Enable(const std::string& filename);
+  void Disable();
+  void Write(bool debug, linear::log::Level level, const char* file, int line, const char* func,
+             const char* format, va_list args);
+
+ private:
+  // call site: format, file and line
+  typedef std::pair<const char*, std::pair<const char*, int> > Site;
+
+  LogBinary(const LogBinary& rhs);
+  LogBinary& operator=(const LogBinary& rhs);
+  uint32_t _GetId(const char* file, int line, const char* func, const char* format);
+
+  FILE* fp_;
+  uint32_t next_id_;
+  std::map<Site, uint32_t> ids_;
+  linear::mutex mutex_;
+};
+
+}  // namespace log
+
+}  // namespace linear
+
+#endif	// LINEAR_LOG_BINARY_H_
@@ -1,3 +1,5 @@
+#include <time.h>
+
 #include "log_file.h"
 
 namespace linear {
@@ -14,6 +16,8 @@ bool LogFile::Available() {
 }
 
 bool LogFile::Enable(const std::string& filename) {
+  // close the file and stop rotating that a previous Enable started
+  LogFile::Disable();
   linear::lock_guard<linear::mutex> lock(mutex_);
 
 #ifdef _WIN32
@@ -28,12 +32,49 @@ bool LogFile::Enable(const std::string& filename) {
   return true;
 }
 
-void LogFile::Disable() {
+bool LogFile::Enable(const std::string& filename, size_t max_size, unsigned int interval, size_t retention) {
+  if (max_size == 0 && interval == 0) {
+    return Enable(filename);
+  }
+  LogFile::Disable();
+#ifdef _WIN32
+  // windows does not rename the next file while the writer keeps it open
+  (void)(retention);
+  return false;
+#else
   linear::lock_guard<linear::mutex> lock(mutex_);
+
+  // append to the current file, so that restarting does not truncate it
+  fp_ = fopen(filename.c_str(), "a");
+
+  if (fp_ == NULL) {
+    return false;
+  }
+  if (!rotator_.Start(filename, retention)) {
+    fclose(fp_);
+    fp_ = NULL;
+    return false;
+  }
+  fseek(fp_, 0, SEEK_END);
+  long size = ftell(fp_);
+  size_ = (size > 0) ? static_cast<size_t>(size) : 0;
+  max_size_ = max_size;
+  interval_ = interval;
+  rotate_at_ = time(NULL) + interval;
+  return true;
+#endif
+}
+
+void LogFile::Disable() {
+  linear::unique_lock<linear::mutex> lock(mutex_);
   if (fp_ != NULL) {
     fclose(fp_);
     fp_ = NULL;
   }
+  max_size_ = 0;
+  interval_ = 0;
+  lock.unlock();
+  rotator_.Stop();
 }
 
 void LogFile::Colorize(bool flag) {
@@ -46,6 +87,51 @@ void LogFile::Write(bool debug, Level level, const char* file, int line, const c
   if (fp_ == NULL) {
     return;
   }
+  Time now;
+  GetTime(&now);
+  _Write(now, debug, level, file, line, func, message);
+  fflush(fp_);
+  _Rotate();
+}
+
+void LogFile::Append(const Time& at, bool debug, Level level, const char* file, int line, const char* func, const char* message) {
+  linear::lock_guard<linear::mutex> lock(mutex_);
+
+  if (fp_ == NULL) {
+    return;
+  }
+  _Write(at, debug, level, file, line, func, message);
+  _Rotate();
+}
+
+void LogFile::Flush() {
+  linear::lock_guard<linear::mutex> lock(mutex_);
+
+  if (fp_ != NULL) {
+    fflush(fp_);
+  }
+}
+
+// swap to the next file when the current one is too big or too old.
+// when the next file is not opened yet, keep writing to the current one and try again later.
+void LogFile::_Rotate() {
+  if (max_size_ == 0 && interval_ == 0) {
+    return;
+  }
+  time_t now = (interval_ > 0) ? time(NULL) : 0;
+  if ((max_size_ == 0 || size_ < max_size_) && (interval_ == 0 || now < rotate_at_)) {
+    return;
+  }
+  FILE* next = rotator_.Rotate(fp_);
+  if (next == NULL) {
+    return;
+  }
+  fp_ = next;
+  size_ = 0;
+  rotate_at_ = now + interval_;
+}
+
+void LogFile::_Write(const Time& at, bool debug, Level level, const char* file, int line, const char* func, const char* message) {
 
 #define LINEAR_LOG_LEVEL_CASE_GEN(IDENT, NUM, LONG_STR, SHORT_STR, COLOR)     \
   case IDENT:                                                                 \
@@ -82,8 +168,8 @@ void LogFile::Write(bool debug, Level level, const char* file, int line, const c
 # undef SEPARATOR
 
   (void)(func);
-  fprintf(fp_, "%s: [%s] (%s:%d) %s\n",
-          GetDateTime().c_str(),
+  int written = fprintf(fp_, "%s: [%s] (%s:%d) %s\n",
+          GetDateTime(at).c_str(),
           strptr,
           (n == std::string::npos) ? fname.c_str() : fname.substr(n + 1).c_str(), line,
           message);
@@ -91,8 +177,11 @@ void LogFile::Write(bool debug, Level level, const char* file, int line, const c
   (void)(file);
   (void)(line);
   (void)(func);
-  fprintf(fp_, "%s: [%s] %s\n", GetDateTime().c_str(), strptr, message);
+  int written = fprintf(fp_, "%s: [%s] %s\n", GetDateTime(at).c_str(), strptr, message);
 #endif
+  if (written > 0) {
+    size_ += written;
+  }
 
   if (color_) {
     fprintf(fp_, "\x1b[%dm", COLOR_DEFAULT);
@@ -100,7 +189,6 @@ void LogFile::Write(bool debug, Level level, const char* file, int line, const c
       fprintf(fp_, "\x1b[0m");
     }
   }
-  fflush(fp_);
 }
 
 }  // namespace log
@@ -2,8 +2,10 @@
 #define	LINEAR_LOG_FILE_H_
 
 #include <stdio.h>
+#include <time.h>
 
 #include "log.h"
+#include "log_rotator.h"
 
 namespace linear {
 
@@ -11,13 +13,19 @@ namespace log {
 
 class LogFile : public Log {
  public:
-  LogFile() : fp_(NULL), color_(false) {}
+  LogFile() : fp_(NULL), color_(false), size_(0), max_size_(0), interval_(0), rotate_at_(0) {}
   ~LogFile();
   virtual bool Available();
   virtual bool Enable(const std::string& filename);
+  // rotate the file when it exceeds max_size (bytes) or interval (sec) passes, 0 means no limit.
+  // rotating is not supported on windows, and returns false.
+  bool Enable(const std::string& filename, size_t max_size, unsigned int interval, size_t retention);
   virtual void Disable();
   void Colorize(bool flag);
   void Write(bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* message);
+  // same as Write, but print the given time and leave the line buffered until Flush
+  void Append(const linear::log::Log::Time& at, bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* message);
+  void Flush();
 
  protected:
   FILE* fp_;
@@ -26,6 +34,14 @@ class LogFile : public Log {
  private:
   LogFile(const LogFile& rhs);
   LogFile& operator=(const LogFile& rhs);
+  void _Write(const linear::log::Log::Time& at, bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* message);
+  void _Rotate();
+
+  size_t size_;
+  size_t max_size_;
+  unsigned int interval_;
+  time_t rotate_at_;
+  linear::log::LogRotator rotator_;
 };
 
 }  // namespace log
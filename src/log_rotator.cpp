@@ -0,0 +1,145 @@
+#include <sstream>
+
+#include "log_rotator.h"
+
+namespace linear {
+
+namespace log {
+
+LogRotator::~LogRotator() {
+  Stop();
+}
+
+bool LogRotator::Start(const std::string& filename, size_t retention) {
+  Stop();
+  linear::lock_guard<linear::mutex> lock(mutex_);
+  try {
+    filename_ = filename;
+  } catch(...) {
+    return false;
+  }
+  retention_ = retention;
+  // open the first next file here, and the following ones in the background thread
+  next_ = fopen(_GetName(0).c_str(), "w");
+  if (next_ == NULL) {
+    return false;
+  }
+  running_ = true;
+  if (uv_thread_create(&thread_, LogRotator::Run, this) != 0) {
+    running_ = false;
+    fclose(next_);
+    next_ = NULL;
+    remove(_GetName(0).c_str());
+    return false;
+  }
+  return true;
+}
+
+void LogRotator::Stop() {
+  linear::unique_lock<linear::mutex> lock(mutex_);
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  cond_.notify_one();
+  lock.unlock();
+  uv_thread_join(&thread_);
+  lock.lock();
+  if (next_ != NULL) {
+    fclose(next_);
+    next_ = NULL;
+    remove(_GetName(0).c_str());
+  }
+}
+
+FILE* LogRotator::Rotate(FILE* current) {
+  linear::lock_guard<linear::mutex> lock(mutex_);
+  if (!running_) {
+    return NULL;
+  }
+  if (next_ == NULL) {
+    cond_.notify_one(); // try to open the next file again
+    return NULL;
+  }
+  try {
+    retired_.push_back(current);
+  } catch(...) {
+    return NULL;
+  }
+  FILE* next = next_;
+  next_ = NULL;
+  cond_.notify_one();
+  return next;
+}
+
+void LogRotator::Run(void* arg) {
+  static_cast<LogRotator*>(arg)->_Run();
+}
+
+void LogRotator::_Run() {
+  linear::unique_lock<linear::mutex> lock(mutex_);
+  while (true) {
+    while (running_ && retired_.empty() && next_ != NULL) {
+      cond_.wait(lock);
+    }
+    std::vector<FILE*> retired;
+    retired.swap(retired_);
+    bool running = running_;
+    lock.unlock();
+
+    // close old files before shifting them, and then open the next file
+    for (std::vector<FILE*>::iterator it = retired.begin(); it != retired.end(); it++) {
+      fclose(*it);
+      _Shift();
+    }
+    FILE* next = NULL;
+    if (running) {
+      next = fopen(_GetName(0).c_str(), "w");
+    }
+
+    lock.lock();
+    if (next != NULL) {
+      if (next_ != NULL) {
+        fclose(next);
+      } else {
+        next_ = next;
+      }
+    }
+    if (!running_ && retired_.empty()) {
+      break;
+    }
+    if (running_ && next_ == NULL && retired_.empty()) {
+      // fail to open the next file, and try again when Rotate is called
+      cond_.wait(lock);
+    }
+  }
+}
+
+void LogRotator::_Shift() {
+  if (retention_ == 0) {
+    remove(filename_.c_str());
+  } else {
+    remove(_GetName(retention_).c_str());
+    for (size_t i = retention_ - 1; i > 0; i--) {
+      rename(_GetName(i).c_str(), _GetName(i + 1).c_str());
+    }
+    rename(filename_.c_str(), _GetName(1).c_str());
+  }
+  rename(_GetName(0).c_str(), filename_.c_str());
+}
+
+// generation 0 is the next file
+std::string LogRotator::_GetName(size_t generation) {
+  std::ostringstream name;
+  name << filename_ << ".";
+  if (generation == 0) {
+    name << "next";
+  } else {
+    name << generation;
+  }
+  return name.str();
+}
+
+}  // namespace log
+
+}  // namespace linear
@@ -0,0 +1,55 @@
+#ifndef	LINEAR_LOG_ROTATOR_H_
+#define	LINEAR_LOG_ROTATOR_H_
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "uv.h"
+
+#include "linear/condition_variable.h"
+
+namespace linear {
+
+namespace log {
+
+// rotate log files in a background thread.
+// the next file is opened in advance as "<filename>.next", and Rotate only swaps the FILE pointer.
+// the old file is closed and generations are shifted later:
+// <filename>.<retention - 1> -> <filename>.<retention>, ..., <filename> -> <filename>.1,
+// and <filename>.next -> <filename>
+// the next file is renamed while it is written, so that this is used only on POSIX systems.
+class LogRotator {
+ public:
+  LogRotator() : retention_(0), next_(NULL), running_(false) {}
+  ~LogRotator();
+  bool Start(const std::string& filename, size_t retention);
+  // close the next file that is not used
+  void Stop();
+  // return the next file instead of current, or NULL when it is not opened yet
+  FILE* Rotate(FILE* current);
+
+ private:
+  LogRotator(const LogRotator& rhs);
+  LogRotator& operator=(const LogRotator& rhs);
+  static void Run(void* arg);
+  void _Run();
+  void _Shift();
+  std::string _GetName(size_t generation);
+
+  std::string filename_;
+  size_t retention_;
+  FILE* next_;
+  std::vector<FILE*> retired_;
+  bool running_;
+  uv_thread_t thread_;
+  linear::mutex mutex_;
+  linear::condition_variable cond_;
+};
+
+}  // namespace log
+
+}  // namespace linear
+
+#endif	// LINEAR_LOG_ROTATOR_H_
@@ -3,16 +3,17 @@
 #include "linear/message.h"
 #include "linear/group.h"
 
+#include "atomic.h"
+#include "packed_notify.h"
+
 using namespace linear::log;
 
 namespace linear {
 
-static linear::mutex g_id_mutex;
+static volatile uint32_t g_id = 0;
 
 static uint32_t GetId() {
-  linear::lock_guard<linear::mutex> lock(g_id_mutex);
-  static uint32_t id = 0;
-  return ++id;
+  return AtomicFetchAndIncrement(&g_id) + 1;
 }
 
 Request::Request() : Message(linear::REQUEST), msgid(GetId()), timeout_(30000) {
@@ -54,9 +55,21 @@ Error Notify::Send(const Socket& socket) const {
   return socket.Send(*this, 0);
 }
 
+// pack the notify once for all sockets of a group.
+// return NULL when out of memory, and then each socket packs the notify by itself.
+static linear::shared_ptr<PackedFrame> PackForGroup(const Notify& notify) {
+  try {
+    linear::shared_ptr<PackedFrame> frame(new PackedFrame());
+    msgpack::pack(frame->buffer, notify);
+    return frame;
+  } catch (...) {
+    return linear::shared_ptr<PackedFrame>();
+  }
+}
+
 void Notify::Send(const std::string& group_name) const {
-  std::set<linear::Socket> sockets = Group::Get(group_name);
-  if (sockets.empty()) {
+  linear::shared_ptr<const std::set<linear::Socket> > sockets = Group::Members(group_name);
+  if (sockets->empty()) {
     return;
   }
   if (group_name == std::string(LINEAR_BROADCAST_GROUP)) {
@@ -64,16 +77,17 @@ void Notify::Send(const std::string& group_name) const {
   } else {
     LINEAR_LOG(LOG_DEBUG, "Send to group: \"%s\"", group_name.c_str());
   }
-  std::set<linear::Socket>::iterator it = sockets.begin();
-  while (it != sockets.end()) {
-    (*it).Send(*this, 0);
+  PackedNotify notify(*this, PackForGroup(*this));
+  std::set<linear::Socket>::const_iterator it = sockets->begin();
+  while (it != sockets->end()) {
+    (*it).Send(notify, 0);
     it++;
   }
 }
 
 void Notify::Send(const std::string& group_name, const Socket& except_socket) const {
-  std::set<linear::Socket> sockets = Group::Get(group_name);
-  if (sockets.empty()) {
+  linear::shared_ptr<const std::set<linear::Socket> > sockets = Group::Members(group_name);
+  if (sockets->empty()) {
     return;
   }
   if (group_name == std::string(LINEAR_BROADCAST_GROUP)) {
@@ -83,10 +97,11 @@ void Notify::Send(const std::string& group_name, const Socket& except_socket) co
     LINEAR_LOG(LOG_DEBUG, "Send to group: \"%s\" except for socket(id = %d)",
                group_name.c_str(), except_socket.GetId());
   }
-  std::set<linear::Socket>::iterator it = sockets.begin();
-  while (it != sockets.end()) {
+  PackedNotify notify(*this, PackForGroup(*this));
+  std::set<linear::Socket>::const_iterator it = sockets->begin();
+  while (it != sockets->end()) {
     if ((*it) != except_socket) {
-      (*it).Send(*this, 0);
+      (*it).Send(notify, 0);
     }
     it++;
   }
@@ -0,0 +1,151 @@
+#include "linear/event_loop.h"
+#include "linear/log.h"
+#include "linear/metrics.h"
+#include "linear/mutex.h"
+
+#include "deadline_queue.h"
+#include "metrics_registry.h"
+#include "socket_impl.h"
+#include "unordered.h"
+
+using namespace linear::log;
+
+namespace linear {
+
+namespace metrics {
+
+struct Registry {
+  Registry() : enabled(false), interval(0), key() {}
+
+  linear::unordered_set<SocketImpl*> sockets;
+  bool enabled;
+  unsigned int interval;
+  DeadlineQueue::Key key;
+  linear::mutex registry_mutex;
+};
+
+static Registry& GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+static shared_ptr<DeadlineQueue> GetQueue() {
+  return EventLoop::GetDefault().GetImpl()->GetDeadlineQueue();
+}
+
+// called in the default event loop thread every interval
+static void Dump(void*) {
+  Registry& registry = GetRegistry();
+  SocketMetrics total;
+  size_t sockets = 0;
+  unique_lock<mutex> lock(registry.registry_mutex);
+  if (!registry.enabled) {
+    return;
+  }
+  for (unordered_set<SocketImpl*>::iterator it = registry.sockets.begin();
+       it != registry.sockets.end(); it++) {
+    SocketMetrics m = (*it)->GetMetrics();
+    total.sent_requests += m.sent_requests;
+    total.sent_responses += m.sent_responses;
+    total.sent_notifies += m.sent_notifies;
+    total.sent_bytes += m.sent_bytes;
+    total.recv_requests += m.recv_requests;
+    total.recv_responses += m.recv_responses;
+    total.recv_notifies += m.recv_notifies;
+    total.recv_bytes += m.recv_bytes;
+    total.send_queue_size += m.send_queue_size;
+    total.pending_requests += m.pending_requests;
+    total.request_timeouts += m.request_timeouts;
+    total.decode_errors += m.decode_errors;
+    total.sent_compressed += m.sent_compressed;
+    total.sent_compressed_bytes += m.sent_compressed_bytes;
+    total.sent_uncompressed_bytes += m.sent_uncompressed_bytes;
+    total.compress_time += m.compress_time;
+    total.recv_compressed += m.recv_compressed;
+    total.recv_compressed_bytes += m.recv_compressed_bytes;
+    total.recv_uncompressed_bytes += m.recv_uncompressed_bytes;
+    total.decompress_time += m.decompress_time;
+    sockets++;
+  }
+  GetQueue()->Add(Dump, registry.interval, NULL, &registry.key);
+  lock.unlock();
+  EventLoopMetrics loop = EventLoop::GetDefault().GetMetrics();
+  LINEAR_LOG(LOG_INFO, "metrics: sockets = %llu, "
+             "sent(requests = %llu, responses = %llu, notifies = %llu, bytes = %llu), "
+             "recv(requests = %llu, responses = %llu, notifies = %llu, bytes = %llu), "
+             "send_queue_size = %llu, pending_requests = %llu, request_timeouts = %llu, decode_errors = %llu, "
+             "compress(messages = %llu, bytes = %llu -> %llu, time = %llu), "
+             "decompress(messages = %llu, bytes = %llu -> %llu, time = %llu), "
+             "loop(lag = %llu, max_lag = %llu, timeouts = %llu)",
+             static_cast<unsigned long long>(sockets),
+             static_cast<unsigned long long>(total.sent_requests),
+             static_cast<unsigned long long>(total.sent_responses),
+             static_cast<unsigned long long>(total.sent_notifies),
+             static_cast<unsigned long long>(total.sent_bytes),
+             static_cast<unsigned long long>(total.recv_requests),
+             static_cast<unsigned long long>(total.recv_responses),
+             static_cast<unsigned long long>(total.recv_notifies),
+             static_cast<unsigned long long>(total.recv_bytes),
+             static_cast<unsigned long long>(total.send_queue_size),
+             static_cast<unsigned long long>(total.pending_requests),
+             static_cast<unsigned long long>(total.request_timeouts),
+             static_cast<unsigned long long>(total.decode_errors),
+             static_cast<unsigned long long>(total.sent_compressed),
+             static_cast<unsigned long long>(total.sent_uncompressed_bytes),
+             static_cast<unsigned long long>(total.sent_compressed_bytes),
+             static_cast<unsigned long long>(total.compress_time),
+             static_cast<unsigned long long>(total.recv_compressed),
+             static_cast<unsigned long long>(total.recv_compressed_bytes),
+             static_cast<unsigned long long>(total.recv_uncompressed_bytes),
+             static_cast<unsigned long long>(total.decompress_time),
+             static_cast<unsigned long long>(loop.lag),
+             static_cast<unsigned long long>(loop.max_lag),
+             static_cast<unsigned long long>(loop.timeouts));
+}
+
+void Register(SocketImpl* socket) {
+  Registry& registry = GetRegistry();
+  lock_guard<mutex> lock(registry.registry_mutex);
+  try {
+    registry.sockets.insert(socket);
+  } catch(...) {
+    LINEAR_LOG(LOG_WARN, "no memory, socket is not counted in metrics");
+  }
+}
+
+void Unregister(SocketImpl* socket) {
+  Registry& registry = GetRegistry();
+  lock_guard<mutex> lock(registry.registry_mutex);
+  registry.sockets.erase(socket);
+}
+
+Error EnableDump(unsigned int interval) {
+  if (interval == 0) {
+    return Error(LNR_EINVAL);
+  }
+  Registry& registry = GetRegistry();
+  lock_guard<mutex> lock(registry.registry_mutex);
+  registry.interval = interval;
+  if (registry.enabled) {
+    return Error(LNR_OK); // new interval is used from the next dump
+  }
+  Error err = GetQueue()->Add(Dump, interval, NULL, &registry.key);
+  if (err == Error(LNR_OK)) {
+    registry.enabled = true;
+  }
+  return err;
+}
+
+void DisableDump() {
+  Registry& registry = GetRegistry();
+  lock_guard<mutex> lock(registry.registry_mutex);
+  if (!registry.enabled) {
+    return;
+  }
+  registry.enabled = false;
+  GetQueue()->Remove(registry.key);
+}
+
+}  // namespace metrics
+
+}  // namespace linear
@@ -0,0 +1,18 @@
+#ifndef LINEAR_METRICS_REGISTRY_H_
+#define LINEAR_METRICS_REGISTRY_H_
+
+namespace linear {
+
+class SocketImpl;
+
+namespace metrics {
+
+// sockets are registered while they are alive, so that the dump can total their metrics
+void Register(linear::SocketImpl* socket);
+void Unregister(linear::SocketImpl* socket);
+
+}  // namespace metrics
+
+}  // namespace linear
+
+#endif  // LINEAR_METRICS_REGISTRY_H_
@@ -1,11 +1,13 @@
 #ifndef LINEAR_NONCE_POOL_H_
 #define LINEAR_NONCE_POOL_H_
 
-#include <vector>
+#include <string>
 
 #include "linear/log.h"
 #include "linear/mutex.h"
-#include "linear/timer.h"
+
+#include "deadline_queue.h"
+#include "unordered.h"
 
 #define NONCE_TIMEOUT (60000) // 1 min
 
@@ -13,75 +15,67 @@ namespace linear {
 
 class NoncePool {
  public:
-  struct TimerCtx {
-    TimerCtx(const std::string& n, NoncePool* p) : nonce(n), pool(p) {}
-    ~TimerCtx() {}
-    std::string nonce;
-    NoncePool* pool;
-  };
   struct Nonce {
-    Nonce() {}
-    Nonce(const std::string& n, TimerCtx* c) : nonce(n), ctx(c) {}
+    Nonce() : pool(NULL), key() {}
+    explicit Nonce(NoncePool* p) : pool(p), key() {}
     ~Nonce() {}
-    std::string nonce;
-    linear::Timer timer;
-    TimerCtx* ctx;
+    NoncePool* pool;
+    linear::DeadlineQueue::Key key;
   };
+  typedef linear::unordered_map<std::string, NoncePool::Nonce> Map;
 
   static void OnTimer(void* args) {
-    NoncePool::TimerCtx* ctx = reinterpret_cast<NoncePool::TimerCtx*>(args);
-    ctx->pool->Remove(ctx->nonce);
+    // args points an element of pool_, which is not moved until erased
+    Map::value_type* entry = reinterpret_cast<Map::value_type*>(args);
+    std::string nonce(entry->first);
+    entry->second.pool->Remove(nonce);
   }
 
  public:
-  NoncePool() {}
+  NoncePool(const linear::shared_ptr<linear::EventLoopImpl>& loop) : queue_(loop->GetDeadlineQueue()) {}
   ~NoncePool() {
     linear::lock_guard<linear::mutex> lock(mutex_);
-    for (std::vector<NoncePool::Nonce>::iterator it = pool_.begin(); it != pool_.end(); it++) {
-      it->timer.Stop();
-      delete it->ctx;
+    for (Map::iterator it = pool_.begin(); it != pool_.end(); it++) {
+      queue_->Remove(it->second.key);
     }
     pool_.clear();
   }
   linear::Error Add(const std::string& nonce, int timeout = NONCE_TIMEOUT) {
     linear::lock_guard<linear::mutex> lock(mutex_);
-    for (std::vector<NoncePool::Nonce>::iterator it = pool_.begin(); it != pool_.end(); it++) {
-      if (nonce == it->nonce) {
-        return Error(LNR_EALREADY);
-      }
+    std::pair<Map::iterator, bool> ret = pool_.insert(std::make_pair(nonce, Nonce(this)));
+    if (!ret.second) {
+      return Error(LNR_EALREADY);
+    }
+    Error e = queue_->Add(NoncePool::OnTimer, timeout, &(*ret.first), &ret.first->second.key);
+    if (e != Error(LNR_OK)) {
+      pool_.erase(ret.first);
+      return e;
     }
-    TimerCtx* c = new TimerCtx(nonce, this);
-    Nonce n(nonce, c);
-    pool_.push_back(n);
     LINEAR_DEBUG(linear::log::LOG_DEBUG, "Nonce(%s...) is valid for %d msecs", nonce.substr(16).c_str(), timeout);
-    return n.timer.Start(NoncePool::OnTimer, timeout, c);
+    return e;
   }
   void Remove(const std::string& nonce) {
     linear::lock_guard<linear::mutex> lock(mutex_);
-    for (std::vector<NoncePool::Nonce>::iterator it = pool_.begin(); it != pool_.end(); it++) {
-      if (nonce == it->nonce) {
-        LINEAR_DEBUG(linear::log::LOG_DEBUG, "Nonce(%s...) is removed", nonce.substr(16).c_str());
-        it->timer.Stop();
-        delete it->ctx;
-        pool_.erase(it);
-        return;
-      }
+    Map::iterator it = pool_.find(nonce);
+    if (it != pool_.end()) {
+      LINEAR_DEBUG(linear::log::LOG_DEBUG, "Nonce(%s...) is removed", nonce.substr(16).c_str());
+      queue_->Remove(it->second.key);
+      pool_.erase(it);
     }
   }
   bool IsValid(const std::string& nonce) {
     linear::lock_guard<linear::mutex> lock(mutex_);
-    for (std::vector<NoncePool::Nonce>::iterator it = pool_.begin(); it != pool_.end(); it++) {
-      if (nonce == it->nonce) {
-        LINEAR_DEBUG(linear::log::LOG_DEBUG, "Nonce(%s...) is valid", nonce.substr(16).c_str());
-        return true;
-      }
+    if (pool_.find(nonce) != pool_.end()) {
+      LINEAR_DEBUG(linear::log::LOG_DEBUG, "Nonce(%s...) is valid", nonce.substr(16).c_str());
+      return true;
     }
     LINEAR_DEBUG(linear::log::LOG_WARN, "Nonce(%s...) is invalid", nonce.substr(16).c_str());
     return false;
   }
 
  protected:
-  std::vector<Nonce> pool_;
+  Map pool_; // key: nonce
+  linear::shared_ptr<linear::DeadlineQueue> queue_;
   linear::mutex mutex_;
 };
 
@@ -0,0 +1,59 @@
+#ifndef LINEAR_PACKED_NOTIFY_H_
+#define LINEAR_PACKED_NOTIFY_H_
+
+#include <vector>
+
+#include "linear/memory.h"
+#include "linear/message.h"
+#include "linear/mutex.h"
+
+#include "compression.h"
+
+namespace linear {
+
+// bytes of a notify packed once, and shared by the copies for every socket of a group.
+// the compressed bytes are made once too, by the first socket that compresses them.
+class PackedFrame {
+ public:
+  PackedFrame() : done_(false), smaller_(false) {}
+  ~PackedFrame() {}
+
+  // return the compressed bytes of buffer, or NULL when they do not get smaller.
+  const std::vector<char>* Compress() {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    if (!done_) {
+      smaller_ = linear::compression::Compress(buffer.data(), buffer.size(), &compressed_);
+      done_ = true;
+    }
+    // compressed_ is never changed after compressed once
+    return smaller_ ? &compressed_ : NULL;
+  }
+
+  msgpack::sbuffer buffer;
+
+ private:
+  PackedFrame(const PackedFrame&);
+  PackedFrame& operator=(const PackedFrame&);
+
+  linear::mutex mutex_;
+  bool done_;
+  bool smaller_;
+  std::vector<char> compressed_;
+};
+
+// notify that is sent by sockets.
+// every notify is copied into this before sent, and sockets write the bytes of frame
+// instead of packing the notify again, or pack it by themselves when frame is NULL.
+// copies made by users through linear::Notify drop the bytes, so they never go stale.
+class PackedNotify : public linear::Notify {
+ public:
+  PackedNotify(const linear::Notify& notify, const linear::shared_ptr<linear::PackedFrame>& f)
+    : Notify(notify), frame(f) {}
+  virtual ~PackedNotify() {}
+
+  linear::shared_ptr<linear::PackedFrame> frame;
+};
+
+} // namespace linear
+
+#endif // LINEAR_PACKED_NOTIFY_H_
@@ -0,0 +1,199 @@
+#include <cstring>
+
+#include "linear/log.h"
+
+#include "resolver.h"
+#include "socket_impl.h"
+
+using namespace linear::log;
+
+namespace linear {
+
+static uint64_t Now() {
+  return uv_hrtime() / 1000000;
+}
+
+static std::vector<Addrinfo> GetAddrinfos(const struct addrinfo* res) {
+  std::vector<Addrinfo> addrs;
+  for (const struct addrinfo* ai = res; ai != NULL; ai = ai->ai_next) {
+    Addrinfo addr(ai->ai_addr);
+    if (addr.proto != Addrinfo::UNKNOWN) {
+      addrs.push_back(addr);
+    }
+  }
+  return addrs;
+}
+
+Resolver::Result Resolver::Lookup(const std::string& host, std::vector<Addrinfo>* addrs, int* status) {
+  // AI_NUMERICHOST never sends DNS queries
+  struct addrinfo hints;
+  struct addrinfo* res = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_NUMERICHOST;
+  if (getaddrinfo(host.c_str(), NULL, &hints, &res) == 0) {
+    *addrs = GetAddrinfos(res);
+    freeaddrinfo(res);
+    if (!addrs->empty()) {
+      return FOUND;
+    }
+  }
+  lock_guard<mutex> lock(mutex_);
+  std::map<std::string, Entry>::iterator it = cache_.find(host);
+  if (it == cache_.end()) {
+    return PENDING;
+  }
+  if (it->second.expire < Now()) {
+    cache_.erase(it);
+    return PENDING;
+  }
+  *addrs = it->second.addrs;
+  *status = it->second.status;
+  return addrs->empty() ? NOT_FOUND : FOUND;
+}
+
+int Resolver::Resolve(const std::string& host, const weak_ptr<SocketImpl>& socket) {
+  lock_guard<mutex> lock(mutex_);
+  if (!running_ && !_Start()) {
+    LINEAR_LOG(LOG_ERR, "fail to start resolver");
+    return UV_EAI_FAIL;
+  }
+  try {
+    std::map<std::string, std::vector<weak_ptr<SocketImpl> > >::iterator it = waiting_.find(host);
+    if (it == waiting_.end()) {
+      it = waiting_.insert(std::make_pair(host, std::vector<weak_ptr<SocketImpl> >())).first;
+      try {
+        queue_.push_back(host);
+      } catch(...) {
+        waiting_.erase(it);
+        throw;
+      }
+    }
+    it->second.push_back(socket);
+  } catch(...) {
+    LINEAR_LOG(LOG_ERR, "no memory");
+    return UV_ENOMEM;
+  }
+  uv_async_send(&async_);
+  return 0;
+}
+
+bool Resolver::_Start() {
+  if (uv_loop_init(&loop_) != 0) {
+    return false;
+  }
+  if (uv_async_init(&loop_, &async_, Resolver::OnAsync) != 0) {
+    uv_loop_close(&loop_);
+    return false;
+  }
+  async_.data = this;
+  if (uv_thread_create(&thread_, Resolver::Run, this) != 0) {
+    uv_close(reinterpret_cast<uv_handle_t*>(&async_), NULL);
+    uv_run(&loop_, UV_RUN_NOWAIT);
+    uv_loop_close(&loop_);
+    return false;
+  }
+  running_ = true;
+  return true;
+}
+
+// the loop never stops, because async_ is never closed
+void Resolver::Run(void* arg) {
+  Resolver* resolver = static_cast<Resolver*>(arg);
+  uv_run(&resolver->loop_, UV_RUN_DEFAULT);
+}
+
+void Resolver::OnAsync(uv_async_t* handle) {
+  Resolver* resolver = static_cast<Resolver*>(handle->data);
+  std::vector<std::string> hosts;
+  unique_lock<mutex> lock(resolver->mutex_);
+  hosts.swap(resolver->queue_);
+  lock.unlock();
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  for (std::vector<std::string>::iterator it = hosts.begin(); it != hosts.end(); it++) {
+    Request* request = NULL;
+    try {
+      request = new Request();
+      request->host = *it;
+    } catch(...) {
+      delete request;
+      resolver->_Complete(*it, std::vector<Addrinfo>(), UV_ENOMEM);
+      continue;
+    }
+    request->resolver = resolver;
+    request->req.data = request;
+    int ret = uv_getaddrinfo(&resolver->loop_, &request->req, Resolver::OnGetaddrinfo,
+                             request->host.c_str(), NULL, &hints);
+    if (ret != 0) {
+      delete request;
+      resolver->_Complete(*it, std::vector<Addrinfo>(), ret);
+    }
+  }
+}
+
+void Resolver::OnGetaddrinfo(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  Request* request = static_cast<Request*>(req->data);
+  Resolver* resolver = request->resolver;
+  std::vector<Addrinfo> addrs;
+  if (status == 0) {
+    try {
+      addrs = GetAddrinfos(res);
+    } catch(...) {
+      status = UV_ENOMEM;
+    }
+    if (status == 0 && addrs.empty()) {
+      status = UV_EAI_NODATA;
+    }
+  }
+  uv_freeaddrinfo(res);
+  LINEAR_LOG(LOG_DEBUG, "resolved \"%s\": %d addresses, %s", request->host.c_str(),
+             static_cast<int>(addrs.size()), (status == 0) ? "ok" : uv_strerror(status));
+  resolver->_Complete(request->host, addrs, status);
+  delete request;
+}
+
+void Resolver::_Complete(const std::string& host, const std::vector<Addrinfo>& addrs, int status) {
+  uint64_t now = Now();
+  std::vector<weak_ptr<SocketImpl> > sockets;
+  unique_lock<mutex> lock(mutex_);
+  if (cache_.size() >= RESOLVER_CACHE_SIZE) {
+    // drop expired entries, or all of them when nothing is expired
+    std::map<std::string, Entry>::iterator it = cache_.begin();
+    while (it != cache_.end()) {
+      if (it->second.expire < now) {
+        cache_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+    if (cache_.size() >= RESOLVER_CACHE_SIZE) {
+      cache_.clear();
+    }
+  }
+  try {
+    Entry& entry = cache_[host];
+    entry.addrs = addrs;
+    entry.status = status;
+    entry.expire = now + ((status == 0) ? RESOLVER_CACHE_TTL : RESOLVER_NEGATIVE_CACHE_TTL);
+  } catch(...) {
+    cache_.erase(host);
+  }
+  std::map<std::string, std::vector<weak_ptr<SocketImpl> > >::iterator it = waiting_.find(host);
+  if (it != waiting_.end()) {
+    sockets.swap(it->second);
+    waiting_.erase(it);
+  }
+  lock.unlock();
+  for (std::vector<weak_ptr<SocketImpl> >::iterator sit = sockets.begin(); sit != sockets.end(); sit++) {
+    if (shared_ptr<SocketImpl> socket = sit->lock()) {
+      socket->OnResolve(socket, addrs, status);
+    }
+  }
+}
+
+}  // namespace linear
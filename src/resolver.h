@@ -0,0 +1,85 @@
+#ifndef LINEAR_RESOLVER_H_
+#define LINEAR_RESOLVER_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "uv.h"
+
+#include "linear/addrinfo.h"
+#include "linear/memory.h"
+#include "linear/mutex.h"
+
+#define RESOLVER_CACHE_TTL          (60000) // msec
+#define RESOLVER_NEGATIVE_CACHE_TTL (5000)  // msec
+#define RESOLVER_CACHE_SIZE         (1024)
+
+namespace linear {
+
+class SocketImpl;
+
+// resolve host names by uv_getaddrinfo, and cache the addresses of them.
+// lookups run in the libuv threadpool at the same time, and their results are
+// delivered from the resolver's own loop thread.
+// the resolver is never destroyed, so that exiting does not wait for lookups in progress.
+class Resolver {
+ public:
+  enum Result {
+    FOUND,
+    NOT_FOUND,
+    PENDING
+  };
+
+  static Resolver& GetInstance() {
+    static Resolver* resolver = new Resolver();
+    return *resolver;
+  }
+
+  // numeric address or cached host name never blocks, and sets addrs or the error of the lookup.
+  // return PENDING for other host names, without resolving them.
+  Result Lookup(const std::string& host, std::vector<linear::Addrinfo>* addrs, int* status);
+  // resolve host, and call socket->OnResolve in the resolver thread after that.
+  // requests for the same host are resolved at once.
+  // return an error of libuv, without calling OnResolve, when the lookup is not started.
+  int Resolve(const std::string& host, const linear::weak_ptr<linear::SocketImpl>& socket);
+
+ private:
+  struct Entry {
+    Entry() : status(0), expire(0) {}
+    std::vector<linear::Addrinfo> addrs;
+    int status; // error of uv_getaddrinfo, 0 when resolved
+    uint64_t expire; // msec
+  };
+  struct Request {
+    Request() : resolver(NULL) {}
+    uv_getaddrinfo_t req;
+    linear::Resolver* resolver;
+    std::string host;
+  };
+
+  Resolver() : running_(false) {}
+  ~Resolver() {}
+  Resolver(const Resolver& rhs);
+  Resolver& operator=(const Resolver& rhs);
+  static void Run(void* arg);
+  static void OnAsync(uv_async_t* handle);
+  static void OnGetaddrinfo(uv_getaddrinfo_t* req, int status, struct addrinfo* res);
+  bool _Start();
+  void _Complete(const std::string& host, const std::vector<linear::Addrinfo>& addrs, int status);
+
+  std::map<std::string, Entry> cache_;
+  std::map<std::string, std::vector<linear::weak_ptr<linear::SocketImpl> > > waiting_;
+  std::vector<std::string> queue_; // hosts to start lookups in the loop thread
+  bool running_;
+  uv_loop_t loop_;
+  uv_async_t async_;
+  uv_thread_t thread_;
+  linear::mutex mutex_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_RESOLVER_H_
@@ -0,0 +1,61 @@
+#include "linear/router.h"
+
+#include "unordered.h"
+
+namespace linear {
+
+class RouterImpl {
+ public:
+  typedef linear::unordered_map<std::string, linear::shared_ptr<Router::IRoute> > Routes;
+
+  Routes routes; // key: method
+};
+
+Router::Router() : router_(new RouterImpl()) {
+}
+
+Router::~Router() {
+}
+
+void Router::Remove(const std::string& method) {
+  router_->routes.erase(method);
+}
+
+void Router::OnResponse(const Socket&, const Response&) {
+}
+
+void Router::OnUnknownMethod(const Socket& socket, const Message& message) {
+  if (message.type == REQUEST) {
+    const Request& request = static_cast<const Request&>(message);
+    Response(request.msgid, type::nil(), std::string("method not found")).Send(socket);
+  }
+}
+
+void Router::OnMessage(const Socket& socket, const Message& message) {
+  const std::string* method;
+  switch(message.type) {
+  case REQUEST:
+    method = &static_cast<const Request&>(message).method;
+    break;
+  case NOTIFY:
+    method = &static_cast<const Notify&>(message).method;
+    break;
+  case RESPONSE:
+    OnResponse(socket, static_cast<const Response&>(message));
+    return;
+  default:
+    return;
+  }
+  RouterImpl::Routes::const_iterator it = router_->routes.find(*method);
+  if (it == router_->routes.end()) {
+    OnUnknownMethod(socket, message);
+    return;
+  }
+  it->second->Fire(socket, message);
+}
+
+void Router::_Add(const std::string& method, const shared_ptr<IRoute>& route) {
+  router_->routes[method] = route;
+}
+
+} // namespace linear
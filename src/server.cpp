@@ -14,6 +14,21 @@ Error Server::SetMaxClients(size_t max_clients) const {
   return Error(LNR_OK);
 }
 
+std::vector<Socket> Server::GetSockets() const {
+  if (!server_) {
+    return std::vector<Socket>();
+  }
+  return server_->GetSockets();
+}
+
+Error Server::SetDispatcher(const Dispatcher& dispatcher) const {
+  if (!server_) {
+    return Error(LNR_EINVAL);
+  }
+  server_->SetDispatcher(dispatcher.GetImpl());
+  return Error(LNR_OK);
+}
+
 Error Server::Start(const std::string& host, int port) const {
   if (!server_) {
     return Error(LNR_EINVAL);
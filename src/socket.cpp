@@ -1,5 +1,6 @@
 #include "linear/log.h"
 
+#include "compression.h"
 #include "socket_impl.h"
 
 using namespace linear::log;
@@ -93,6 +94,41 @@ Error Socket::SetMaxRecvBufferSize(size_t limit) const {
   return Error(LNR_OK);
 }
 
+Error Socket::SetSendBatchSize(size_t limit) const {
+  if (!socket_) {
+    return Error(LNR_EBADF);
+  }
+  socket_->SetSendBatchSize(limit);
+  return Error(LNR_OK);
+}
+
+Error Socket::SetPerSocketMsgid(bool enable) const {
+  if (!socket_) {
+    return Error(LNR_EBADF);
+  }
+  socket_->SetPerSocketMsgid(enable);
+  return Error(LNR_OK);
+}
+
+Error Socket::SetMethodInterning(bool enable) const {
+  if (!socket_) {
+    return Error(LNR_EBADF);
+  }
+  socket_->SetMethodInterning(enable);
+  return Error(LNR_OK);
+}
+
+Error Socket::SetCompression(size_t threshold) const {
+  if (!socket_) {
+    return Error(LNR_EBADF);
+  }
+  if (threshold > 0 && !compression::Available()) {
+    return Error(LNR_ENOTSUP);
+  }
+  socket_->SetCompression(threshold);
+  return Error(LNR_OK);
+}
+
 Error Socket::Connect(unsigned int timeout) const {
   if (!socket_) {
     return Error(LNR_EBADF);
@@ -184,6 +220,38 @@ const Addrinfo& Socket::GetPeerInfo() const {
   return socket_->GetPeerInfo();
 }
 
+size_t Socket::GetInFlightRequestCount() const {
+  if (!socket_) {
+    return 0;
+  }
+  return socket_->GetInFlightRequestCount();
+}
+
+SocketMetrics Socket::GetMetrics() const {
+  if (!socket_) {
+    return SocketMetrics();
+  }
+  return socket_->GetMetrics();
+}
+
+size_t Socket::GetSendQueueSize() const {
+  if (!socket_) {
+    return 0;
+  }
+  return socket_->GetSendQueueSize();
+}
+
+Error Socket::SetSendWatermark(size_t high, size_t low) const {
+  if (!socket_) {
+    return Error(LNR_EBADF);
+  }
+  if (high > 0 && low > high) {
+    return Error(LNR_EINVAL);
+  }
+  socket_->SetSendWatermark(high, low);
+  return Error(LNR_OK);
+}
+
 Error Socket::Send(const Message& message, int timeout) const {
   if (!socket_) {
     return Error(LNR_EBADF);
@@ -1,9 +1,16 @@
 #include <sstream>
+#include <typeinfo>
 
 #include "linear/ws_socket.h"
 
 #include "ws_socket_impl.h"
+#include "atomic.h"
+#include "compression.h"
 #include "handler_delegate.h"
+#include "metrics_registry.h"
+#include "packed_notify.h"
+#include "resolver.h"
+#include "write_buffer_pool.h"
 
 #ifdef WITH_SSL
 # include "linear/wss_socket.h"
@@ -14,16 +21,17 @@ using namespace linear::log;
 
 namespace linear {
 
-static linear::mutex g_id_mutex;
+const char* const SocketImpl::INTERN_METHOD = "$linear.intern";
+const char* const SocketImpl::COMPRESS_METHOD = "$linear.compress";
+
+static volatile uint32_t g_id = 0;
 
 static int Id() {
-  lock_guard<mutex> lock(g_id_mutex);
-  static int id = 0;
-  return id++;
+  return static_cast<int>(AtomicFetchAndIncrement(&g_id) & 0x7fffffff);
 }
 
-static std::string GetTypeString(Socket::Type type) {
-  std::string proto("NIL");
+static const char* GetTypeString(Socket::Type type) {
+  const char* proto = "NIL";
   switch(type) {
   case Socket::TCP:
     proto = "TCP";
@@ -44,25 +52,122 @@ static std::string GetTypeString(Socket::Type type) {
   return proto;  
 }
 
+// print Addrinfo as "addr:port" or "[addr]:port" without building a string for each log
+#define ADDRINFO_FORMAT "%s%s%s:%d"
+#define ADDRINFO_ARGS(info)                                     \
+  ((info).proto == Addrinfo::IPv4) ? "" : "[", (info).addr.c_str(), \
+  ((info).proto == Addrinfo::IPv4) ? "" : "]", (info).port
+
+// let decoded STR, BIN and EXT objects point into the read buffer instead of copying them.
+// the buffer is kept alive by the zones of the messages that refer to it.
+static bool ReferenceBuffer(msgpack::type::object_type, size_t, void*) {
+  return true;
+}
+
+static void ReleaseReadBuffer(void* holder) {
+  delete reinterpret_cast<shared_ptr<char>*>(holder);
+}
+
+template <typename T>
+static bool Pack(WriteBuffer* buffer, const T& message) {
+  try {
+    msgpack::pack(*buffer, message);
+  } catch (const std::bad_alloc&) {
+    return false;
+  }
+  return true;
+}
+
+// pack method as a string, an id or a definition of the id ([id, method])
+static void PackMethod(msgpack::packer<WriteBuffer>& pk, const std::string& method, int64_t id, bool define) {
+  if (id < 0) {
+    pk.pack(method);
+  } else if (define) {
+    pk.pack_array(2);
+    pk.pack(static_cast<uint32_t>(id));
+    pk.pack(method);
+  } else {
+    pk.pack(static_cast<uint32_t>(id));
+  }
+}
+
+static bool PackRequest(WriteBuffer* buffer, const Request& request, int64_t id, bool define) {
+  try {
+    msgpack::packer<WriteBuffer> pk(*buffer);
+    pk.pack_array(4);
+    pk.pack(request.type);
+    pk.pack(request.msgid);
+    PackMethod(pk, request.method, id, define);
+    pk.pack(request.params);
+  } catch (const std::bad_alloc&) {
+    return false;
+  }
+  return true;
+}
+
+static bool PackNotify(WriteBuffer* buffer, const Notify& notify, int64_t id, bool define) {
+  try {
+    msgpack::packer<WriteBuffer> pk(*buffer);
+    pk.pack_array(3);
+    pk.pack(notify.type);
+    PackMethod(pk, notify.method, id, define);
+    pk.pack(notify.params);
+  } catch (const std::bad_alloc&) {
+    return false;
+  }
+  return true;
+}
+
+// the notifies sent by linear itself are not reported to handlers
+static bool IsHello(const Message* message) {
+  return (message->type == NOTIFY &&
+          (static_cast<const Notify*>(message)->method == SocketImpl::INTERN_METHOD ||
+           static_cast<const Notify*>(message)->method == SocketImpl::COMPRESS_METHOD));
+}
+
+// copy bytes packed in advance
+static bool Write(WriteBuffer* buffer, const msgpack::sbuffer& packed) {
+  try {
+    buffer->write(packed.data(), packed.size());
+  } catch (const std::bad_alloc&) {
+    return false;
+  }
+  return true;
+}
+
 // Client Socket
 SocketImpl::SocketImpl(const std::string& host, int port,
                        const linear::shared_ptr<linear::EventLoopImpl>& loop,
                        const weak_ptr<HandlerDelegate>& delegate,
                        Socket::Type type)
   : state_(Socket::DISCONNECTED),
-    stream_(NULL), ev_(NULL), peer_(Addrinfo(host, port)), loop_(loop), type_(type), id_(Id()),
-    connectable_(true), handshaking_(false), last_error_(LNR_OK), delegate_(delegate),
-    connect_timeout_(0), connect_timer_(loop_) {
+    stream_(NULL), ev_(NULL), addr_index_(0), loop_(loop), type_(type), id_(Id()),
+    connectable_(true), handshaking_(false), resolving_(false), last_error_(LNR_OK), delegate_(delegate),
+    connect_timeout_(0), connect_timer_(loop_),
+    writing_(0), send_batch_size_(Socket::DEFAULT_SEND_BATCH_SIZE), batch_(NULL),
+    per_socket_msgid_(false), msgid_(0),
+    recv_requests_(0), recv_responses_(0), recv_notifies_(0), recv_bytes_(0), decode_errors_(0),
+    request_timeouts_(0), connect_start_(0), high_watermark_(0), low_watermark_(0), wait_writable_(false),
+    method_interning_(false), intern_hello_sent_(false), peer_interning_(false),
+    compression_threshold_(0),
+    compress_hello_sent_(false), peer_compression_(false),
+    recv_compressed_(0), recv_compressed_bytes_(0), recv_uncompressed_bytes_(0), decompress_time_(0) {
   SetMaxBufferSize(Socket::DEFAULT_MAX_BUFFER_SIZE);
-  if (peer_.proto == Addrinfo::UNKNOWN) {
-    LINEAR_LOG(LOG_ERR, "fail to create socket(id = %d, type = %s, peer = [%s]:%d, connectable): address not available",
-               id_, GetTypeString(type_).c_str(),
-               host.c_str(), port);
+  metrics::Register(this);
+  // do not resolve host here, because sockets may be created in event loop threads
+  peer_.addr = host;
+  peer_.port = port;
+  std::vector<Addrinfo> addrs;
+  int status = 0;
+  if (Resolver::GetInstance().Lookup(host, &addrs, &status) == Resolver::FOUND) {
+    peer_.proto = addrs.front().proto;
+    LINEAR_LOG(LOG_DEBUG, "socket(id = %d, type = %s, peer = " ADDRINFO_FORMAT ", connectable) is created",
+               id_, GetTypeString(type_),
+               ADDRINFO_ARGS(peer_));
   } else {
-    LINEAR_LOG(LOG_DEBUG, "socket(id = %d, type = %s, peer = %s:%d, connectable) is created",
-               id_, GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+    LINEAR_LOG(LOG_DEBUG, "socket(id = %d, type = %s, peer = %s:%d, connectable) is created, host is resolved at connect",
+               id_, GetTypeString(type_),
+               host.c_str(), port);
   }
 }
 
@@ -71,9 +176,17 @@ SocketImpl::SocketImpl(tv_stream_t* stream,
                        const linear::shared_ptr<linear::EventLoopImpl>& loop,
                        const weak_ptr<HandlerDelegate>& delegate,
                        Socket::Type type)
-  : stream_(stream), ev_(NULL), loop_(loop), type_(type), id_(Id()),
-    connectable_(false), last_error_(LNR_OK), delegate_(delegate),
-    connect_timeout_(0), connect_timer_(loop_) {
+  : stream_(stream), ev_(NULL), addr_index_(0), loop_(loop), type_(type), id_(Id()),
+    connectable_(false), resolving_(false), last_error_(LNR_OK), delegate_(delegate),
+    connect_timeout_(0), connect_timer_(loop_),
+    writing_(0), send_batch_size_(Socket::DEFAULT_SEND_BATCH_SIZE), batch_(NULL),
+    per_socket_msgid_(false), msgid_(0),
+    recv_requests_(0), recv_responses_(0), recv_notifies_(0), recv_bytes_(0), decode_errors_(0),
+    request_timeouts_(0), connect_start_(uv_hrtime()), high_watermark_(0), low_watermark_(0), wait_writable_(false),
+    method_interning_(false), intern_hello_sent_(false), peer_interning_(false),
+    compression_threshold_(0),
+    compress_hello_sent_(false), peer_compression_(false),
+    recv_compressed_(0), recv_compressed_bytes_(0), recv_uncompressed_bytes_(0), decompress_time_(0) {
   if (type == Socket::WS) {
     handshaking_ = true;
     state_ = Socket::CONNECTING;
@@ -110,19 +223,55 @@ SocketImpl::SocketImpl(tv_stream_t* stream,
                id_, tv_strerror(reinterpret_cast<tv_handle_t*>(stream_), ret));
   }
   SetMaxBufferSize(Socket::DEFAULT_MAX_BUFFER_SIZE);
-  LINEAR_LOG(LOG_DEBUG, "socket(id = %d, type = %s, self = %s:%d, peer = %s:%d, not connectable) is created",
-             id_, GetTypeString(type_).c_str(),
-             (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-             self_.port,
-             (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-             peer_.port);
+  metrics::Register(this);
+  LINEAR_LOG(LOG_DEBUG, "socket(id = %d, type = %s, self = " ADDRINFO_FORMAT ", peer = " ADDRINFO_FORMAT ", not connectable) is created",
+             id_, GetTypeString(type_),
+             ADDRINFO_ARGS(self_),
+             ADDRINFO_ARGS(peer_));
 }
 
 SocketImpl::~SocketImpl() {
-  Disconnect(false);
+  metrics::Unregister(this);
+  if (resolving_) {
+    // no stream owns ev_, and OnConnectTimeout can not be called any more
+    connect_timer_.Stop();
+    delete ev_;
+  } else {
+    Disconnect(false);
+  }
   LINEAR_LOG(LOG_DEBUG, "socket(id = %d) is destroyed", id_);
 }
 
+size_t SocketImpl::GetInFlightRequestCount() {
+  lock_guard<mutex> request_timer_lock(request_timer_mutex_);
+  return request_timers_.size();
+}
+
+SocketMetrics SocketImpl::GetMetrics() {
+  SocketMetrics metrics;
+  unique_lock<mutex> send_lock(send_mutex_);
+  metrics = metrics_;
+  send_lock.unlock();
+  metrics.recv_requests = AtomicLoad(&recv_requests_);
+  metrics.recv_responses = AtomicLoad(&recv_responses_);
+  metrics.recv_notifies = AtomicLoad(&recv_notifies_);
+  metrics.recv_bytes = AtomicLoad(&recv_bytes_);
+  metrics.decode_errors = AtomicLoad(&decode_errors_);
+  metrics.recv_compressed = AtomicLoad(&recv_compressed_);
+  metrics.recv_compressed_bytes = AtomicLoad(&recv_compressed_bytes_);
+  metrics.recv_uncompressed_bytes = AtomicLoad(&recv_uncompressed_bytes_);
+  metrics.decompress_time = AtomicLoad(&decompress_time_);
+  lock_guard<mutex> request_timer_lock(request_timer_mutex_);
+  metrics.pending_requests = request_timers_.size();
+  metrics.request_timeouts = request_timeouts_;
+  return metrics;
+}
+
+size_t SocketImpl::GetSendQueueSize() {
+  lock_guard<mutex> send_lock(send_mutex_);
+  return metrics_.send_queue_size;
+}
+
 void SocketImpl::SetMaxBufferSize(size_t limit) {
   SetMaxSendBufferSize(limit);
   SetMaxRecvBufferSize(limit);
@@ -139,9 +288,43 @@ void SocketImpl::SetMaxRecvBufferSize(size_t limit) {
   max_recv_buffer_size_ = limit;
 }
 
+void SocketImpl::SetSendBatchSize(size_t limit) {
+  lock_guard<mutex> send_lock(send_mutex_);
+  send_batch_size_ = limit;
+}
+
+void SocketImpl::SetPerSocketMsgid(bool enable) {
+  lock_guard<mutex> state_lock(state_mutex_);
+  per_socket_msgid_ = enable;
+}
+
+void SocketImpl::SetMethodInterning(bool enable) {
+  lock_guard<mutex> state_lock(state_mutex_);
+  method_interning_ = enable;
+}
+
+void SocketImpl::SetCompression(size_t threshold) {
+  lock_guard<mutex> state_lock(state_mutex_);
+  compression_threshold_ = threshold;
+}
+
+void SocketImpl::SetSendWatermark(size_t high, size_t low) {
+  lock_guard<mutex> send_lock(send_mutex_);
+  high_watermark_ = high;
+  low_watermark_ = low;
+  if (high_watermark_ == 0) {
+    wait_writable_ = false;
+  }
+}
+
+void SocketImpl::RecordConnectTime() {
+  lock_guard<mutex> send_lock(send_mutex_);
+  metrics_.connect_time = (uv_hrtime() - connect_start_) / 1000; // usec
+}
+
 Error SocketImpl::Connect(unsigned int timeout, EventLoopImpl::SocketEvent* ev) {
   lock_guard<mutex> state_lock(state_mutex_);
-  if (!connectable_ || peer_.proto == Addrinfo::UNKNOWN) {
+  if (!connectable_) {
     LINEAR_LOG(LOG_WARN, "this socket(id = %d) is not connectable", id_);
     return Error(LNR_EINVAL);
   }
@@ -154,11 +337,27 @@ Error SocketImpl::Connect(unsigned int timeout, EventLoopImpl::SocketEvent* ev)
     LINEAR_LOG(LOG_WARN, "this socket(id = %d) is disconnecting now.plz call later.", id_);
     return Error(LNR_EBUSY);
   }
-  LINEAR_LOG(LOG_DEBUG, "try to connect(id = %d): --- %s --> %s:%d",
+  // TCP connects to resolved addresses.
+  // SSL, WS and WSS pass host name to tv_connect, because they need it for SNI or Host header
+  bool resolving = false;
+  addrs_.clear();
+  addr_index_ = 0;
+  if (type_ == Socket::TCP) {
+    int status = 0;
+    Resolver::Result result = Resolver::GetInstance().Lookup(peer_.addr, &addrs_, &status);
+    if (result == Resolver::NOT_FOUND) {
+      Error err(status);
+      LINEAR_LOG(LOG_WARN, "fail to connect(id = %d), %s: %s:%d is not resolvable",
+                 id_, err.Message().c_str(), peer_.addr.c_str(), peer_.port);
+      return err;
+    }
+    resolving = (result == Resolver::PENDING);
+  }
+  LINEAR_LOG(LOG_DEBUG, "try to connect(id = %d): --- %s --> " ADDRINFO_FORMAT "%s",
              id_,
-             GetTypeString(type_).c_str(),
-             (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-             peer_.port);
+             GetTypeString(type_),
+             ADDRINFO_ARGS(peer_),
+             resolving ? ", resolving host" : "");
   ev_ = ev;
   Error err;
   shared_ptr<HandlerDelegate> delegate = delegate_.lock();
@@ -171,7 +370,19 @@ Error SocketImpl::Connect(unsigned int timeout, EventLoopImpl::SocketEvent* ev)
     }
   }
   self_ = Addrinfo(); // reset self info
-  err = Connect();
+  unique_lock<mutex> send_lock(send_mutex_);
+  connect_start_ = uv_hrtime();
+  send_lock.unlock();
+  if (resolving) {
+    // OnResolve calls Connect() later, and the connect timer includes the time to resolve
+    int ret = Resolver::GetInstance().Resolve(peer_.addr, socket);
+    err = Error(ret);
+    if (ret == 0) {
+      resolving_ = true;
+    }
+  } else {
+    err = Connect();
+  }
   if (err == Error(LNR_OK)) {
     state_ = Socket::CONNECTING;
     if (timeout > 0) {
@@ -195,8 +406,12 @@ Error SocketImpl::Disconnect(bool handshaking) {
   if (state_ == Socket::DISCONNECTING || state_ == Socket::DISCONNECTED) {
     return Error(LNR_EALREADY);
   }
-  connect_timer_.Stop();
   state_ = Socket::DISCONNECTING;
+  if (resolving_) {
+    _AbortConnect(Error(LNR_OK));
+    return Error(LNR_OK);
+  }
+  connect_timer_.Stop();
   last_error_ = Error(LNR_OK);
   tv_close(reinterpret_cast<tv_handle_t*>(stream_), EventLoopImpl::OnClose);
   return Error(LNR_OK);
@@ -207,6 +422,12 @@ Error SocketImpl::Send(const Message& message, int timeout) {
   if (state_ == Socket::DISCONNECTING || state_ == Socket::DISCONNECTED) {
     return Error(LNR_ENOTCONN);
   }
+  unique_lock<mutex> send_lock(send_mutex_);
+  if (high_watermark_ > 0 && metrics_.send_queue_size >= high_watermark_) {
+    wait_writable_ = true;
+    return Error(LNR_EAGAIN);
+  }
+  send_lock.unlock();
   try {
     Message* copy_message;
     switch(message.type) {
@@ -214,6 +435,9 @@ Error SocketImpl::Send(const Message& message, int timeout) {
       {
         Request* copy_request = new Request(static_cast<const Request&>(message));
         copy_request->timeout_ = timeout;
+        if (per_socket_msgid_) {
+          copy_request->msgid = ++msgid_;
+        }
         copy_message = copy_request;
       }
       break;
@@ -221,12 +445,23 @@ Error SocketImpl::Send(const Message& message, int timeout) {
       copy_message = new Response(static_cast<const Response&>(message));
       break;
     case linear::NOTIFY:
-      copy_message = new Notify(static_cast<const Notify&>(message));
+      // _Send takes every notify as a PackedNotify
+      if (typeid(message) == typeid(PackedNotify)) {
+        copy_message = new PackedNotify(static_cast<const PackedNotify&>(message));
+      } else {
+        copy_message = new PackedNotify(static_cast<const Notify&>(message), shared_ptr<PackedFrame>());
+      }
       break;
     default:
       LINEAR_LOG(LOG_ERR, "invalid type of message: %d", message.type);
       throw std::bad_typeid();
     }
+    if (method_interning_) {
+      _SendHello(INTERN_METHOD, &intern_hello_sent_);
+    }
+    if (compression_threshold_ > 0) {
+      _SendHello(COMPRESS_METHOD, &compress_hello_sent_);
+    }
     if (state_ == Socket::CONNECTING) {
       pending_messages_.push_back(copy_message);
       return Error(LNR_OK);
@@ -295,28 +530,29 @@ Error SocketImpl::StartRead(EventLoopImpl::SocketEvent* ev) {
     tv_close(reinterpret_cast<tv_handle_t*>(stream_), EventLoopImpl::OnClose);
     return Error(ret);
   }
-  LINEAR_LOG(LOG_DEBUG, "connected(id = %d): %s:%d <-- %s --> %s:%d",
+  LINEAR_LOG(LOG_DEBUG, "connected(id = %d): " ADDRINFO_FORMAT " <-- %s --> " ADDRINFO_FORMAT,
              id_,
-             (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-             self_.port,
-             GetTypeString(type_).c_str(),
-             (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-             peer_.port);
+             ADDRINFO_ARGS(self_),
+             GetTypeString(type_),
+             ADDRINFO_ARGS(peer_));
   return Error(LNR_OK);
 }
 
 void SocketImpl::OnConnect(const shared_ptr<SocketImpl>& socket, tv_stream_t* stream, int status) {
   unique_lock<mutex> state_lock(state_mutex_);
+  // the connect timer keeps running while trying the next address
+  if (status && status != TV_ETIMEDOUT && state_ == Socket::CONNECTING && _ConnectNextAddress(stream)) {
+    return;
+  }
   connect_timer_.Stop();
   if (state_ == Socket::CONNECTED) {
     return;
   }
   if (state_ != Socket::CONNECTING) {
-    LINEAR_LOG(LOG_DEBUG, "connect(id = %d) is cancelled: x-- %s --> %s:%d",
+    LINEAR_LOG(LOG_DEBUG, "connect(id = %d) is cancelled: x-- %s --> " ADDRINFO_FORMAT,
                id_,
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               GetTypeString(type_),
+               ADDRINFO_ARGS(peer_));
     return;
   }
   if (status) {
@@ -337,12 +573,11 @@ void SocketImpl::OnConnect(const shared_ptr<SocketImpl>& socket, tv_stream_t* st
     (void)(stream);
 #endif
 
-    LINEAR_LOG(LOG_DEBUG, "fail to connect(id = %d), %s: --- %s --x %s:%d",
+    LINEAR_LOG(LOG_DEBUG, "fail to connect(id = %d), %s: --- %s --x " ADDRINFO_FORMAT,
                id_,
                last_error_.Message().c_str(),
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               GetTypeString(type_),
+               ADDRINFO_ARGS(peer_));
     state_lock.unlock();
     tv_close(reinterpret_cast<tv_handle_t*>(stream_), EventLoopImpl::OnClose);
     return;
@@ -356,18 +591,22 @@ void SocketImpl::OnConnect(const shared_ptr<SocketImpl>& socket, tv_stream_t* st
   if (ret == 0) {
     self_ = Addrinfo(&addr.sa);
   }
+  if (peer_.proto == Addrinfo::UNKNOWN) {
+    len = sizeof(addr);
+    if (tv_getpeername(stream_, &addr.sa, &len) == 0) {
+      peer_.proto = Addrinfo(&addr.sa).proto;
+    }
+  }
   SetMaxSendBufferSize(max_send_buffer_size_);
   // OK.starts to read
   last_error_ = StartRead(ev_);
   if (last_error_ != Error(LNR_OK)) {
-    LINEAR_LOG(LOG_DEBUG, "fail to connect(id = %d), %s: %s:%d --- %s --x %s:%d",
+    LINEAR_LOG(LOG_DEBUG, "fail to connect(id = %d), %s: " ADDRINFO_FORMAT " --- %s --x " ADDRINFO_FORMAT,
                id_,
                last_error_.Message().c_str(),
-               (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-               self_.port,
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               ADDRINFO_ARGS(self_),
+               GetTypeString(type_),
+               ADDRINFO_ARGS(peer_));
     return;
   }
   state_lock.unlock();
@@ -402,14 +641,14 @@ void SocketImpl::OnDisconnect(const shared_ptr<SocketImpl>& socket) {
   if (state_ == Socket::DISCONNECTED) {
     return;
   }
-  LINEAR_LOG(LOG_DEBUG, "disconnected(id = %d): %s:%d x-- %s --x %s:%d",
+  LINEAR_LOG(LOG_DEBUG, "disconnected(id = %d): " ADDRINFO_FORMAT " x-- %s --x " ADDRINFO_FORMAT,
              id_,
-             (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-             self_.port,
-             GetTypeString(type_).c_str(),
-             (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-             peer_.port);
+             ADDRINFO_ARGS(self_),
+             GetTypeString(type_),
+             ADDRINFO_ARGS(peer_));
   state_ = Socket::DISCONNECTED;
+  intern_hello_sent_ = false;
+  compress_hello_sent_ = false;
   state_lock.unlock();
   shared_ptr<HandlerDelegate> delegate = delegate_.lock();
   if (delegate) {
@@ -477,18 +716,6 @@ void SocketImpl::OnDisconnect(const shared_ptr<SocketImpl>& socket) {
   return;
 }
 
-class _Response : public Message {
- public:
-  _Response() : Message(linear::RESPONSE), msgid(0) {}
-  ~_Response() {}
-
- public:
-  uint32_t msgid;
-  linear::type::any result;
-  linear::type::any error;
-  MSGPACK_DEFINE(type, msgid, error, result);
-};
-
 void SocketImpl::OnRead(const shared_ptr<SocketImpl>& socket, const tv_buf_t* buffer, ssize_t nread) {
   unique_lock<mutex> state_lock(state_mutex_);
   if (state_ != Socket::CONNECTING && state_ != Socket::CONNECTED) {
@@ -508,121 +735,245 @@ void SocketImpl::OnRead(const shared_ptr<SocketImpl>& socket, const tv_buf_t* bu
 
   assert(nread != 0);
   if (nread <= 0) {
-    LINEAR_LOG(LOG_DEBUG, "%s(id = %d): %s:%d --- %s --x %s:%d",
+    LINEAR_LOG(LOG_DEBUG, "%s(id = %d): " ADDRINFO_FORMAT " --- %s --x " ADDRINFO_FORMAT,
                tv_strerror(reinterpret_cast<tv_handle_t*>(stream_), nread),
                id_,
-               (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-               self_.port,
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               ADDRINFO_ARGS(self_),
+               GetTypeString(type_),
+               ADDRINFO_ARGS(peer_));
     // error or EOF
     Disconnect(handshaking_);
     last_error_ = e;
     return;
   }
   // nread > 0
-  unpacker_.reserve_buffer(nread);
-  memcpy(unpacker_.buffer(), buffer->base, nread);
-  free(buffer->base);
-  unpacker_.buffer_consumed(nread);
+  AtomicAdd(&recv_bytes_, static_cast<uint64_t>(nread));
   shared_ptr<HandlerDelegate> delegate = delegate_.lock();
   try {
-    msgpack::object_handle result;
-    while (unpacker_.next(result)) {
-      msgpack::object obj = result.get();
-      Message message = obj.as<Message>();
-      switch(message.type) {
-      case REQUEST:
-        {
-          Request request = obj.as<Request>();
-          LINEAR_LOG(LOG_DEBUG, "recv request(id = %d): msgid = %u, method = \"%s\", params = %s, %s:%d <-- %s --- %s:%d",
-                     id_, request.msgid,
-                     request.method.c_str(), LINEAR_LOG_PRINTABLE_STRING(request.params).c_str(),
-                     (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                     self_.port,
-                     GetTypeString(type_).c_str(),
-                     (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                     peer_.port);
-          if (delegate) {
-            delegate->OnMessage(socket, request);
-          }
-        }
-        break;
-      case RESPONSE:
-        {
-          _Response _response = obj.as<_Response>();
-          LINEAR_LOG(LOG_DEBUG, "recv response(id = %d): msgid = %u, result = %s, error = %s, %s:%d <-- %s --- %s:%d",
-                     id_, _response.msgid,
-                     LINEAR_LOG_PRINTABLE_STRING(_response.result).c_str(),
-                     LINEAR_LOG_PRINTABLE_STRING(_response.error).c_str(),
-                     (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                     self_.port,
-                     GetTypeString(type_).c_str(),
-                     (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                     peer_.port);
-          unique_lock<mutex> request_timer_lock(request_timer_mutex_);
-          for (std::vector<SocketImpl::RequestTimer*>::iterator it = request_timers_.begin();
-               it != request_timers_.end(); it++) {
-            const Request& request = (*it)->request;
-            if (request.msgid == _response.msgid) {
-              Response response(_response.msgid, _response.result, _response.error, request);
-              delete *it;
-              request_timers_.erase(it);
-              request_timer_lock.unlock();
-              if (delegate) {
-                delegate->OnMessage(socket, response);
-              }
-              break;
-            }
-          }
+    // freed when the last message that refers to it is destroyed
+    shared_ptr<char> read_buffer(buffer->base, free);
+    size_t offset = 0;
+    if (unpacker_.nonparsed_size() == 0) {
+      // decode complete messages in place, without copying them into the unpacker
+      while (offset < static_cast<size_t>(nread)) {
+        msgpack::object_handle result;
+        bool referenced = false;
+        try {
+          msgpack::unpack(result, buffer->base, nread, offset, referenced, ReferenceBuffer);
+        } catch (const msgpack::insufficient_bytes&) {
+          break;
         }
-        break;
-      case NOTIFY:
-        {
-          Notify notify = obj.as<Notify>();
-          LINEAR_LOG(LOG_DEBUG, "recv notify(id = %d): method = \"%s\", params = %s, %s:%d <-- %s --- %s:%d",
-                     id_,
-                     notify.method.c_str(), LINEAR_LOG_PRINTABLE_STRING(notify.params).c_str(),
-                     (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                     self_.port,
-                     GetTypeString(type_).c_str(),
-                     (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                     peer_.port);
-          if (delegate) {
-            delegate->OnMessage(socket, notify);
+        if (referenced) {
+          shared_ptr<char>* holder = new shared_ptr<char>(read_buffer);
+          try {
+            result.zone()->push_finalizer(ReleaseReadBuffer, holder);
+          } catch (...) {
+            delete holder;
+            throw;
           }
-          break;
         }
-        break;
-      default:
-        throw std::bad_cast();
+        _Dispatch(socket, delegate, result);
+      }
+    }
+    if (offset < static_cast<size_t>(nread)) {
+      // keep the rest (a partial message) in the unpacker until the next read
+      size_t rest = nread - offset;
+      unpacker_.reserve_buffer(rest);
+      memcpy(unpacker_.buffer(), buffer->base + offset, rest);
+      unpacker_.buffer_consumed(rest);
+      msgpack::object_handle result;
+      while (unpacker_.next(result)) {
+        _Dispatch(socket, delegate, result);
       }
     }
     if (unpacker_.message_size() > max_recv_buffer_size_) {
       throw std::runtime_error("");
     }
   } catch (const std::bad_cast&) {
-    LINEAR_LOG(LOG_WARN, "recv invalid message(id = %d): %s:%d <-- %s -- %s:%d",
+    AtomicAdd(&decode_errors_, 1);
+    LINEAR_LOG(LOG_WARN, "recv invalid message(id = %d): " ADDRINFO_FORMAT " <-- %s -- " ADDRINFO_FORMAT,
                id_,
-               (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-               self_.port,
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               ADDRINFO_ARGS(self_),
+               GetTypeString(type_),
+               ADDRINFO_ARGS(peer_));
     Disconnect();
   } catch (...) {
-    LINEAR_LOG(LOG_ERR, "recv malformed or big message(id = %d): %s:%d <-- %s -- %s:%d",
+    AtomicAdd(&decode_errors_, 1);
+    LINEAR_LOG(LOG_ERR, "recv malformed or big message(id = %d): " ADDRINFO_FORMAT " <-- %s -- " ADDRINFO_FORMAT,
                id_,
-               (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-               self_.port,
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               ADDRINFO_ARGS(self_),
+               GetTypeString(type_),
+               ADDRINFO_ARGS(peer_));
     Disconnect();
   }
 }
 
+void SocketImpl::_Dispatch(const shared_ptr<SocketImpl>& socket, const shared_ptr<HandlerDelegate>& delegate,
+                           msgpack::object_handle& handle) {
+  const msgpack::object& obj = handle.get();
+  if (obj.type == msgpack::type::EXT) {
+    msgpack::object_handle decompressed;
+    _Decompress(obj, &decompressed);
+    _Dispatch(socket, delegate, decompressed);
+    return;
+  }
+  // every message is an array that starts with its type, so read the tag from the array header
+  // and convert the object only once into the concrete message
+  if (obj.type != msgpack::type::ARRAY || obj.via.array.size == 0 ||
+      obj.via.array.ptr[0].type != msgpack::type::POSITIVE_INTEGER) {
+    throw std::bad_cast();
+  }
+  // fields are converted one by one, in the same way as MSGPACK_DEFINE,
+  // so that params, result and error share the zone of the decoded message instead of copying it
+  shared_ptr<msgpack::zone> zone(handle.zone().release());
+  const msgpack::object* fields = obj.via.array.ptr;
+  uint32_t size = obj.via.array.size;
+  switch(fields[0].via.u64) {
+  case REQUEST:
+    {
+      Request request;
+      if (size > 1) {
+        fields[1].convert(request.msgid);
+      }
+      if (size > 2) {
+        _ConvertMethod(fields[2], &request.method);
+      }
+      if (size > 3) {
+        request.params = type::any(fields[3], zone);
+      }
+      AtomicAdd(&recv_requests_, 1);
+      LINEAR_LOG(LOG_DEBUG, "recv request(id = %d): msgid = %u, method = \"%s\", params = %s, " ADDRINFO_FORMAT " <-- %s --- " ADDRINFO_FORMAT,
+                 id_, request.msgid,
+                 request.method.c_str(), LINEAR_LOG_PRINTABLE_STRING(request.params).c_str(),
+                 ADDRINFO_ARGS(self_),
+                 GetTypeString(type_),
+                 ADDRINFO_ARGS(peer_));
+      if (delegate) {
+        delegate->OnMessage(socket, request);
+      }
+    }
+    break;
+  case RESPONSE:
+    {
+      Response response;
+      if (size > 1) {
+        fields[1].convert(response.msgid);
+      }
+      if (size > 2) {
+        response.error = type::any(fields[2], zone);
+      }
+      if (size > 3) {
+        response.result = type::any(fields[3], zone);
+      }
+      AtomicAdd(&recv_responses_, 1);
+      LINEAR_LOG(LOG_DEBUG, "recv response(id = %d): msgid = %u, result = %s, error = %s, " ADDRINFO_FORMAT " <-- %s --- " ADDRINFO_FORMAT,
+                 id_, response.msgid,
+                 LINEAR_LOG_PRINTABLE_STRING(response.result).c_str(),
+                 LINEAR_LOG_PRINTABLE_STRING(response.error).c_str(),
+                 ADDRINFO_ARGS(self_),
+                 GetTypeString(type_),
+                 ADDRINFO_ARGS(peer_));
+      unique_lock<mutex> request_timer_lock(request_timer_mutex_);
+      unordered_map<uint32_t, SocketImpl::RequestTimer*>::iterator it = request_timers_.find(response.msgid);
+      if (it != request_timers_.end()) {
+        response.request = it->second->request;
+        delete it->second;
+        request_timers_.erase(it);
+        request_timer_lock.unlock();
+        if (delegate) {
+          delegate->OnMessage(socket, response);
+        }
+      }
+    }
+    break;
+  case NOTIFY:
+    {
+      Notify notify;
+      if (size > 1) {
+        _ConvertMethod(fields[1], &notify.method);
+      }
+      if (size > 2) {
+        notify.params = type::any(fields[2], zone);
+      }
+      AtomicAdd(&recv_notifies_, 1);
+      // the notify is consumed even if method interning is disabled on this socket,
+      // because it is not a message for handlers
+      if (notify.method == INTERN_METHOD) {
+        unique_lock<mutex> state_lock(state_mutex_);
+        bool interning = method_interning_;
+        state_lock.unlock();
+        if (interning) {
+          lock_guard<mutex> send_lock(send_mutex_);
+          peer_interning_ = true;
+        }
+        break;
+      } else if (notify.method == COMPRESS_METHOD) {
+        unique_lock<mutex> state_lock(state_mutex_);
+        bool compression = (compression_threshold_ > 0);
+        state_lock.unlock();
+        if (compression) {
+          lock_guard<mutex> send_lock(send_mutex_);
+          peer_compression_ = true;
+        }
+        break;
+      }
+      LINEAR_LOG(LOG_DEBUG, "recv notify(id = %d): method = \"%s\", params = %s, " ADDRINFO_FORMAT " <-- %s --- " ADDRINFO_FORMAT,
+                 id_,
+                 notify.method.c_str(), LINEAR_LOG_PRINTABLE_STRING(notify.params).c_str(),
+                 ADDRINFO_ARGS(self_),
+                 GetTypeString(type_),
+                 ADDRINFO_ARGS(peer_));
+      if (delegate) {
+        delegate->OnMessage(socket, notify);
+      }
+    }
+    break;
+  default:
+    throw std::bad_cast();
+  }
+}
+
+void SocketImpl::OnWrite(const shared_ptr<SocketImpl>& socket, const WriteBuffer* buffer, int status) {
+  // write messages batched while this write was in flight
+  unique_lock<mutex> send_lock(send_mutex_);
+  writing_--;
+  _DequeueBytes(buffer->size);
+  WriteBuffer* batch = batch_;
+  batch_ = NULL;
+  int ret = 0;
+  if (batch != NULL) {
+    ret = tv_write(&batch->request, stream_,
+                   static_cast<tv_buf_t>(uv_buf_init(batch->data, batch->size)), EventLoopImpl::OnWrite);
+    if (ret == 0) {
+      writing_++;
+    } else {
+      _DequeueBytes(batch->size);
+    }
+  }
+  bool writable = (wait_writable_ && metrics_.send_queue_size <= low_watermark_);
+  if (writable) {
+    wait_writable_ = false;
+  }
+  send_lock.unlock();
+  for (std::vector<Message*>::const_iterator it = buffer->messages.begin();
+       it != buffer->messages.end(); it++) {
+    OnWrite(socket, *it, status);
+  }
+  if (batch != NULL && ret) {
+    for (std::vector<Message*>::iterator it = batch->messages.begin();
+         it != batch->messages.end(); it++) {
+      OnWrite(socket, *it, ret);
+      delete *it;
+    }
+    WriteBufferPool::Release(batch);
+  }
+  if (writable) {
+    if (shared_ptr<HandlerDelegate> delegate = delegate_.lock()) {
+      delegate->OnWritable(socket);
+    }
+  }
+}
+
 void SocketImpl::OnWrite(const shared_ptr<SocketImpl>& socket, const Message* message, int status) {
   assert(message != NULL);
   if (status) {
@@ -635,16 +986,12 @@ void SocketImpl::OnWrite(const shared_ptr<SocketImpl>& socket, const Message* me
 	{
 	  linear::Request request_fail = *(static_cast<const Request*>(message));
 	  unique_lock<mutex> request_timer_lock(request_timer_mutex_);
-	  for (std::vector<SocketImpl::RequestTimer*>::iterator it = request_timers_.begin();
-	       it != request_timers_.end(); it++) {
-	    const Request& request = (*it)->request;
-	    if (request.msgid == request_fail.msgid) {
-	      delete *it;
-	      request_timers_.erase(it);
-	      request_timer_lock.unlock();
-	      break;
-	    }
+	  unordered_map<uint32_t, SocketImpl::RequestTimer*>::iterator it = request_timers_.find(request_fail.msgid);
+	  if (it != request_timers_.end()) {
+	    delete it->second;
+	    request_timers_.erase(it);
 	  }
+	  request_timer_lock.unlock();
 	  delegate->OnError(socket, request_fail, Error(status));
 	}
         break;
@@ -652,7 +999,9 @@ void SocketImpl::OnWrite(const shared_ptr<SocketImpl>& socket, const Message* me
         delegate->OnError(socket, *(static_cast<const Response*>(message)), Error(status));
         break;
       case NOTIFY:
-        delegate->OnError(socket, *(static_cast<const Notify*>(message)), Error(status));
+        if (!IsHello(message)) {
+          delegate->OnError(socket, *(static_cast<const Notify*>(message)), Error(status));
+        }
         break;
       default:
         LINEAR_LOG(LOG_ERR, "BUG: invalid type of message");
@@ -662,21 +1011,63 @@ void SocketImpl::OnWrite(const shared_ptr<SocketImpl>& socket, const Message* me
   }
 }
 
+void SocketImpl::OnResolve(const shared_ptr<SocketImpl>&, const std::vector<Addrinfo>& addrs, int status) {
+  lock_guard<mutex> state_lock(state_mutex_);
+  if (!resolving_ || state_ != Socket::CONNECTING) {
+    return; // disconnected while resolving host
+  }
+  Error err(status);
+  if (status == 0) {
+    try {
+      addrs_ = addrs;
+      addr_index_ = 0;
+      err = Connect();
+    } catch(...) {
+      LINEAR_LOG(LOG_ERR, "no memory");
+      err = Error(LNR_ENOMEM);
+    }
+  }
+  if (err == Error(LNR_OK)) {
+    resolving_ = false;
+    return;
+  }
+  LINEAR_LOG(LOG_DEBUG, "fail to connect(id = %d), %s: --- %s --x %s:%d",
+             id_,
+             err.Message().c_str(),
+             GetTypeString(type_),
+             peer_.addr.c_str(), peer_.port);
+  state_ = Socket::DISCONNECTING;
+  _AbortConnect(err);
+}
+
 void SocketImpl::OnConnectTimeout(const shared_ptr<SocketImpl>& socket) {
-  OnConnect(socket, stream_, TV_ETIMEDOUT);
+  unique_lock<mutex> state_lock(state_mutex_);
+  if (!resolving_) {
+    state_lock.unlock();
+    OnConnect(socket, stream_, TV_ETIMEDOUT);
+    return;
+  }
+  // no stream is created, so finish connect here instead of OnClose
+  resolving_ = false;
+  if (state_ == Socket::CONNECTING) {
+    state_ = Socket::DISCONNECTING;
+    last_error_ = Error(TV_ETIMEDOUT);
+  }
+  EventLoopImpl::SocketEvent* ev = ev_;
+  ev_ = NULL;
+  state_lock.unlock();
+  OnDisconnect(socket);
+  delete ev;
 }
 
 void SocketImpl::OnRequestTimeout(const shared_ptr<SocketImpl>& socket, const Request& request) {
   unique_lock<mutex> request_timer_lock(request_timer_mutex_);
-  for (std::vector<SocketImpl::RequestTimer*>::iterator it = request_timers_.begin();
-       it != request_timers_.end(); it++) {
-    const Request& ref = (*it)->request;
-    if (ref.msgid == request.msgid) {
-      LINEAR_LOG(LOG_INFO, "occur request timeout(id = %d): msgid = %d",
-                 id_, request.msgid);
-      request_timers_.erase(it);
-      break;
-    }
+  unordered_map<uint32_t, SocketImpl::RequestTimer*>::iterator it = request_timers_.find(request.msgid);
+  if (it != request_timers_.end()) {
+    LINEAR_LOG(LOG_INFO, "occur request timeout(id = %d): msgid = %d",
+               id_, request.msgid);
+    request_timers_.erase(it);
+    request_timeouts_++;
   }
   request_timer_lock.unlock();
   if (shared_ptr<HandlerDelegate> delegate = delegate_.lock()) {
@@ -687,26 +1078,52 @@ void SocketImpl::OnRequestTimeout(const shared_ptr<SocketImpl>& socket, const Re
 Error SocketImpl::_Send(Message* message) {
   assert(message != NULL);
   RequestTimer* request_timer = NULL;
-  msgpack::sbuffer sbuf;
+  // pack the message straight into a pooled buffer, which is passed to tv_write without copying.
+  // while another write is in flight, the message is appended to the batch instead,
+  // and the batch is written when that write completes.
+  // a pending batch is always appended to, even if batching has been disabled since it was started,
+  // so that its messages are neither orphaned nor overtaken.
+  unique_lock<mutex> send_lock(send_mutex_);
+  bool batching = (batch_ != NULL || writing_ > 0);
+  WriteBuffer* buffer = batch_;
+  if (buffer == NULL) {
+    buffer = WriteBufferPool::Acquire(loop_->GetWriteBufferPool());
+  }
+  if (buffer == NULL) {
+    Error err(LNR_ENOMEM);
+    LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
+               id_, err.Message().c_str());
+    return err;
+  }
+  size_t mark = buffer->size;
+  bool packed = false;
+  bool define = false;
+  int64_t method_id = -1;
+  const std::string* defined = NULL; // method whose id is defined by this message, forgotten if fail to send
+  PackedFrame* frame = NULL;         // bytes packed once for a group
   switch(message->type) {
   case REQUEST:
     {
       const Request* request = static_cast<const Request*>(message);
-      LINEAR_LOG(LOG_DEBUG, "send request(id = %d): msgid = %u, method = \"%s\", params = %s, %s:%d --- %s --> %s:%d",
+      LINEAR_LOG(LOG_DEBUG, "send request(id = %d): msgid = %u, method = \"%s\", params = %s, " ADDRINFO_FORMAT " --- %s --> " ADDRINFO_FORMAT,
                  id_,
                  request->msgid, request->method.c_str(), LINEAR_LOG_PRINTABLE_STRING(request->params).c_str(),
-                 (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                 self_.port,
-                 GetTypeString(type_).c_str(),
-                 (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                 peer_.port);
-      msgpack::pack(sbuf, *request);
+                 ADDRINFO_ARGS(self_),
+                 GetTypeString(type_),
+                 ADDRINFO_ARGS(peer_));
+      method_id = _InternMethod(request->method, &define);
+      defined = define ? &request->method : NULL;
+      packed = (method_id < 0) ? Pack(buffer, *request) : PackRequest(buffer, *request, method_id, define);
       try {
 	request_timer = new RequestTimer(*request, ev_->socket, loop_);
       } catch(...) {
 	Error err(LNR_ENOMEM);
 	LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
 		   id_, err.Message().c_str());
+	_CancelWrite(buffer, mark);
+	if (defined != NULL) {
+	  send_methods_.erase(*defined);
+	}
 	return err;
       }
       break;
@@ -714,82 +1131,305 @@ Error SocketImpl::_Send(Message* message) {
   case RESPONSE:
     {
       const Response* response = static_cast<const Response*>(message);
-      LINEAR_LOG(LOG_DEBUG, "send response(id = %d): msgid = %u, result = %s, error = %s, %s:%d --- %s --> %s:%d",
+      LINEAR_LOG(LOG_DEBUG, "send response(id = %d): msgid = %u, result = %s, error = %s, " ADDRINFO_FORMAT " --- %s --> " ADDRINFO_FORMAT,
                  id_,
                  response->msgid,
                  LINEAR_LOG_PRINTABLE_STRING(response->result).c_str(),
                  LINEAR_LOG_PRINTABLE_STRING(response->error).c_str(),
-                 (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                 self_.port,
-                 GetTypeString(type_).c_str(),
-                 (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                 peer_.port);
-      msgpack::pack(sbuf, *response);
+                 ADDRINFO_ARGS(self_),
+                 GetTypeString(type_),
+                 ADDRINFO_ARGS(peer_));
+      packed = Pack(buffer, *response);
       break;
     }
   case NOTIFY:
     {
       const Notify* notify = static_cast<const Notify*>(message);
-      LINEAR_LOG(LOG_DEBUG, "send notify(id = %d): method = \"%s\", params = %s, %s:%d --- %s --> %s:%d",
+      LINEAR_LOG(LOG_DEBUG, "send notify(id = %d): method = \"%s\", params = %s, " ADDRINFO_FORMAT " --- %s --> " ADDRINFO_FORMAT,
                  id_,
                  notify->method.c_str(), LINEAR_LOG_PRINTABLE_STRING(notify->params).c_str(),
-                 (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                 self_.port,
-                 GetTypeString(type_).c_str(),
-                 (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                 peer_.port);
-      msgpack::pack(sbuf, *notify);
+                 ADDRINFO_ARGS(self_),
+                 GetTypeString(type_),
+                 ADDRINFO_ARGS(peer_));
+      frame = static_cast<const PackedNotify*>(notify)->frame.get();
+      if (frame != NULL) {
+        packed = Write(buffer, frame->buffer);
+      } else {
+        method_id = _InternMethod(notify->method, &define);
+        defined = define ? &notify->method : NULL;
+        packed = (method_id < 0) ? Pack(buffer, *notify) : PackNotify(buffer, *notify, method_id, define);
+      }
       break;
     }
   default:
     LINEAR_LOG(LOG_ERR, "invalid type of message: %d", message->type);
+    _CancelWrite(buffer, mark);
     return Error(LNR_EINVAL);
   }
-  char* copy_data = static_cast<char*>(malloc(sbuf.size()));
-  if (copy_data == NULL) {
-    Error err(LNR_ENOMEM);
-    LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
-               id_, err.Message().c_str());
-    if (request_timer != NULL) {
-      delete request_timer;
+  if (packed && peer_compression_ && compression_threshold_ > 0 &&
+      buffer->size - mark >= compression_threshold_) {
+    _Compress(buffer, mark, frame);
+  }
+  if (packed) {
+    try {
+      buffer->messages.push_back(message);
+    } catch(...) {
+      packed = false;
     }
-    return err;
   }
-  memcpy(copy_data, sbuf.data(), sbuf.size());
-  tv_buf_t buffer = static_cast<tv_buf_t>(uv_buf_init(copy_data, sbuf.size()));
-  tv_write_t* w = static_cast<tv_write_t*>(malloc(sizeof(tv_write_t)));
-  if (w == NULL) {
+  if (!packed) {
     Error err(LNR_ENOMEM);
     LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
                id_, err.Message().c_str());
-    free(copy_data);
+    _CancelWrite(buffer, mark);
+    if (defined != NULL) {
+      send_methods_.erase(*defined);
+    }
     if (request_timer != NULL) {
       delete request_timer;
     }
     return err;
   }
-  w->data = message;
-  int ret = tv_write(w, stream_, buffer, EventLoopImpl::OnWrite);
-  if (ret) { // EINVAL or ENOMEM
-    Error err(ret);
-    free(w);
-    free(copy_data);
-    if (request_timer != NULL) {
-      delete request_timer;
+  size_t bytes = buffer->size - mark;
+  if (batching && writing_ > 0 && buffer->size < send_batch_size_) { // otherwise flush the batch now
+    batch_ = buffer;
+  } else {
+    batch_ = NULL;
+    int ret = tv_write(&buffer->request, stream_,
+                       static_cast<tv_buf_t>(uv_buf_init(buffer->data, buffer->size)), EventLoopImpl::OnWrite);
+    if (ret) { // EINVAL or ENOMEM
+      Error err(ret);
+      buffer->messages.pop_back();
+      _CancelWrite(buffer, mark);
+      if (defined != NULL) {
+        send_methods_.erase(*defined);
+      }
+      if (request_timer != NULL) {
+        delete request_timer;
+      }
+      LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
+                 id_, err.Message().c_str());
+      return err;
     }
-    LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
-               id_, err.Message().c_str());
-    return err;
+    writing_++;
+  }
+  metrics_.send_queue_size += bytes;
+  metrics_.sent_bytes += bytes;
+  switch(message->type) {
+  case REQUEST:
+    metrics_.sent_requests++;
+    break;
+  case RESPONSE:
+    metrics_.sent_responses++;
+    break;
+  case NOTIFY:
+  default:
+    metrics_.sent_notifies++;
+    break;
   }
+  send_lock.unlock();
   if (request_timer != NULL) {
     unique_lock<mutex> request_timer_lock(request_timer_mutex_);
-    request_timers_.push_back(request_timer);
+    request_timers_.insert(std::make_pair(request_timer->request.msgid, request_timer));
     request_timer_lock.unlock();
     request_timer->Start();
   }
   return Error(LNR_OK);
 }
 
+// called with send_mutex_ locked
+void SocketImpl::_DequeueBytes(size_t bytes) {
+  metrics_.send_queue_size = (metrics_.send_queue_size > bytes) ? metrics_.send_queue_size - bytes : 0;
+}
+
+// replace the message packed from mark with a compressed ext object, when it gets smaller.
+// the bytes of frame are compressed once and shared by every socket of the group.
+// called with state_mutex_ and send_mutex_ locked.
+void SocketImpl::_Compress(WriteBuffer* buffer, size_t mark, PackedFrame* frame) {
+  size_t size = buffer->size - mark;
+  std::vector<char> compressed;
+  const std::vector<char>* result = NULL;
+  uint64_t start = uv_hrtime();
+  if (frame != NULL) {
+    result = frame->Compress();
+  } else if (compression::Compress(buffer->data + mark, size, &compressed)) {
+    result = &compressed;
+  }
+  metrics_.compress_time += (uv_hrtime() - start) / 1000; // usec
+  // 6 bytes for the header of ext 32, so that the ext object is written over the message without realloc
+  if (result == NULL || result->size() + 6 > size) {
+    return;
+  }
+  buffer->size = mark;
+  msgpack::packer<WriteBuffer> pk(*buffer);
+  pk.pack_ext(result->size(), compression::EXT_TYPE);
+  pk.pack_ext_body(&(*result)[0], static_cast<uint32_t>(result->size()));
+  metrics_.sent_compressed++;
+  metrics_.sent_uncompressed_bytes += size;
+  metrics_.sent_compressed_bytes += buffer->size - mark;
+}
+
+// unpack the message wrapped by a compressed ext object into handle.
+// called in the event loop thread.
+void SocketImpl::_Decompress(const msgpack::object& obj, msgpack::object_handle* handle) {
+  if (obj.via.ext.type() != compression::EXT_TYPE) {
+    throw std::bad_cast();
+  }
+  size_t size = 0;
+  uint64_t start = uv_hrtime();
+  char* data = compression::Decompress(obj.via.ext.data(), obj.via.ext.size, max_recv_buffer_size_, &size);
+  if (data == NULL) {
+    throw std::bad_cast();
+  }
+  // freed when the last object that refers to it is destroyed, as well as read buffers
+  shared_ptr<char> decompressed(data, free);
+  size_t offset = 0;
+  bool referenced = false;
+  msgpack::unpack(*handle, data, size, offset, referenced, ReferenceBuffer);
+  if (offset != size || handle->get().type == msgpack::type::EXT) {
+    throw std::bad_cast();
+  }
+  if (referenced) {
+    shared_ptr<char>* holder = new shared_ptr<char>(decompressed);
+    try {
+      handle->zone()->push_finalizer(ReleaseReadBuffer, holder);
+    } catch (...) {
+      delete holder;
+      throw;
+    }
+  }
+  AtomicAdd(&decompress_time_, (uv_hrtime() - start) / 1000); // usec
+  AtomicAdd(&recv_compressed_, 1);
+  AtomicAdd(&recv_compressed_bytes_, obj.via.ext.size);
+  AtomicAdd(&recv_uncompressed_bytes_, size);
+}
+
+// tell the peer that this socket understands methods sent as ids (INTERN_METHOD)
+// or compressed messages (COMPRESS_METHOD), before the first message.
+// called with state_mutex_ locked, and messages are sent as usual if this fails.
+void SocketImpl::_SendHello(const char* method, bool* sent) {
+  if (*sent) {
+    return;
+  }
+  Notify* hello = NULL;
+  try {
+    hello = new PackedNotify(Notify(std::string(method), type::nil()), shared_ptr<PackedFrame>());
+    if (state_ == Socket::CONNECTING) {
+      pending_messages_.push_back(hello);
+      *sent = true;
+      return;
+    }
+  } catch(...) {
+    delete hello;
+    return;
+  }
+  if (_Send(hello) == Error(LNR_OK)) {
+    *sent = true;
+  } else {
+    delete hello;
+  }
+}
+
+// return id of the method, or -1 to send it as a string.
+// define is set when the id is new and must be defined to the peer.
+// called with send_mutex_ locked.
+int64_t SocketImpl::_InternMethod(const std::string& method, bool* define) {
+  *define = false;
+  if (!peer_interning_) {
+    return -1;
+  }
+  unordered_map<std::string, uint32_t>::iterator it = send_methods_.find(method);
+  if (it != send_methods_.end()) {
+    return it->second;
+  }
+  if (send_methods_.size() >= MAX_INTERNED_METHODS) {
+    return -1;
+  }
+  uint32_t id = static_cast<uint32_t>(send_methods_.size());
+  try {
+    send_methods_.insert(std::make_pair(method, id));
+  } catch(...) {
+    return -1;
+  }
+  *define = true;
+  return id;
+}
+
+// convert method sent as a string, an id or a definition of the id.
+// called in the event loop thread.
+void SocketImpl::_ConvertMethod(const msgpack::object& obj, std::string* method) {
+  if (obj.type == msgpack::type::POSITIVE_INTEGER) {
+    if (obj.via.u64 >= recv_methods_.size()) {
+      throw std::bad_cast();
+    }
+    *method = recv_methods_[obj.via.u64];
+  } else if (obj.type == msgpack::type::ARRAY) {
+    if (obj.via.array.size != 2 || obj.via.array.ptr[0].type != msgpack::type::POSITIVE_INTEGER ||
+        obj.via.array.ptr[0].via.u64 != recv_methods_.size() || recv_methods_.size() >= MAX_INTERNED_METHODS) {
+      throw std::bad_cast();
+    }
+    obj.via.array.ptr[1].convert(*method);
+    recv_methods_.push_back(*method);
+  } else {
+    obj.convert(*method);
+  }
+}
+
+// drop the message packed from mark.
+// messages already batched before it are kept in batch_ to be written later.
+// must be called with state_mutex_ locked, after changing state_ to DISCONNECTING.
+// ev_ is not owned by a stream, so call OnConnectTimeout in the event loop thread to finish connect.
+void SocketImpl::_AbortConnect(const Error& err) {
+  resolving_ = true;
+  last_error_ = err;
+  connect_timer_.Stop();
+  Error e = connect_timer_.Start(EventLoopImpl::OnConnectTimeout, 0, ev_);
+  if (e != Error(LNR_OK)) {
+    LINEAR_LOG(LOG_ERR, "fail to abort connect(id = %d): %s", id_, e.Message().c_str());
+  }
+}
+
+// must be called with state_mutex_ locked.
+// retire the stream failed to connect, and connect to the next resolved address
+bool SocketImpl::_ConnectNextAddress(tv_stream_t* stream) {
+  if (addr_index_ + 1 >= addrs_.size()) {
+    return false;
+  }
+  EventLoopImpl::SocketEvent* retired = NULL;
+  try {
+    // OnClose of the stream does not call OnDisconnect
+    retired = new EventLoopImpl::SocketEvent(shared_ptr<SocketImpl>());
+  } catch(...) {
+    LINEAR_LOG(LOG_ERR, "no memory");
+    return false;
+  }
+  LINEAR_LOG(LOG_DEBUG, "fail to connect(id = %d): --- %s --x %s, try next address",
+             id_,
+             GetTypeString(type_),
+             addrs_[addr_index_].addr.c_str());
+  stream->data = retired;
+  tv_close(reinterpret_cast<tv_handle_t*>(stream), EventLoopImpl::OnClose);
+  addr_index_++;
+  Error err = Connect();
+  if (err != Error(LNR_OK)) {
+    state_ = Socket::DISCONNECTING;
+    _AbortConnect(err);
+  }
+  return true;
+}
+
+void SocketImpl::_CancelWrite(WriteBuffer* buffer, size_t mark) {
+  buffer->size = mark;
+  if (buffer->messages.empty()) {
+    if (batch_ == buffer) {
+      batch_ = NULL;
+    }
+    WriteBufferPool::Release(buffer);
+  } else {
+    batch_ = buffer;
+  }
+}
+
 void SocketImpl::_SendPendingMessages(const shared_ptr<SocketImpl>& socket) {
   unique_lock<mutex> state_lock(state_mutex_);
   // Send pending messages
@@ -813,7 +1453,7 @@ void SocketImpl::_SendPendingMessages(const shared_ptr<SocketImpl>& socket) {
   for (std::vector<Message*>::iterator it = fail_to_send.begin();
        it != fail_to_send.end(); it++) {
     Message* message = *it;
-    if (delegate) {
+    if (delegate && !IsHello(message)) {
       switch(message->type) {
       case REQUEST:
         delegate->OnError(socket, *(static_cast<Request*>(message)), pending_err);
@@ -838,10 +1478,34 @@ void SocketImpl::_DiscardMessages(const shared_ptr<SocketImpl>& socket) {
   shared_ptr<HandlerDelegate> delegate = delegate_.lock();
   std::vector<Message*> fail_to_send;
   fail_to_send.swap(pending_messages_);
+  // all writes are done when the stream is closed, but the batch may remain.
+  // requests in the batch are notified through their request timers below.
+  unique_lock<mutex> send_lock(send_mutex_);
+  if (batch_ != NULL) {
+    for (std::vector<Message*>::iterator it = batch_->messages.begin();
+         it != batch_->messages.end(); it++) {
+      if ((*it)->type == REQUEST) {
+        delete *it;
+      } else {
+        fail_to_send.push_back(*it);
+      }
+    }
+    batch_->messages.clear();
+    WriteBufferPool::Release(batch_);
+    batch_ = NULL;
+  }
+  writing_ = 0;
+  metrics_.send_queue_size = 0;
+  wait_writable_ = false;
+  peer_interning_ = false;
+  send_methods_.clear();
+  peer_compression_ = false;
+  send_lock.unlock();
+  recv_methods_.clear();
   for (std::vector<Message*>::iterator it = fail_to_send.begin();
        it != fail_to_send.end(); it++) {
     Message* message = *it;
-    if (delegate) {
+    if (delegate && !IsHello(message)) {
       switch(message->type) {
       case REQUEST:
         delegate->OnError(socket, *(static_cast<Request*>(message)), err);
@@ -860,16 +1524,16 @@ void SocketImpl::_DiscardMessages(const shared_ptr<SocketImpl>& socket) {
     delete message;
   }
 
-  std::vector<RequestTimer*> cancelled_requests;
+  unordered_map<uint32_t, RequestTimer*> cancelled_requests;
   unique_lock<mutex> request_timer_lock(request_timer_mutex_);
   cancelled_requests.swap(request_timers_);
   request_timer_lock.unlock();
-  for (std::vector<RequestTimer*>::iterator it = cancelled_requests.begin();
+  for (unordered_map<uint32_t, RequestTimer*>::iterator it = cancelled_requests.begin();
        it != cancelled_requests.end(); it++) {
     if (delegate) {
-      delegate->OnError(socket, (*it)->request, err);
+      delegate->OnError(socket, it->second->request, err);
     }
-    delete *it;
+    delete it->second;
   }
 }
 
@@ -2,35 +2,47 @@
 #define LINEAR_SOCKET_IMPL_H_
 
 #include "linear/message.h"
+#include "linear/metrics.h"
 #include "linear/mutex.h"
 #include "linear/timer.h"
 
+#include "deadline_queue.h"
 #include "event_loop_impl.h"
+#include "unordered.h"
 
 namespace linear {
 
 class HandlerDelegate;
+class PackedFrame;
+struct WriteBuffer;
 
 class SocketImpl {
  public:
+  // method of the notify that tells the peer to send methods as ids
+  static const char* const INTERN_METHOD;
+  static const size_t MAX_INTERNED_METHODS = 1024; // per direction of a connection
+  // method of the notify that tells the peer to send compressed messages
+  static const char* const COMPRESS_METHOD;
+
   class RequestTimer {
    public:
     RequestTimer(const linear::Request& r, const linear::weak_ptr<linear::SocketImpl> s,
                  const linear::shared_ptr<linear::EventLoopImpl> l)
-      : request(r), socket(s), timer(l) {}
+      : request(r), socket(s), queue(l->GetDeadlineQueue()), key() {}
     ~RequestTimer() {
       Stop();
     }
     void Start() {
-      timer.Start(linear::EventLoopImpl::OnRequestTimeout, static_cast<uint64_t>(request.timeout_), this);
+      queue->Add(linear::EventLoopImpl::OnRequestTimeout, static_cast<unsigned int>(request.timeout_), this, &key);
     }
     void Stop() {
-      timer.Stop();
+      queue->Remove(key);
     }
    public:
     linear::Request request;
     linear::weak_ptr<linear::SocketImpl> socket;
-    linear::Timer timer;
+    linear::shared_ptr<linear::DeadlineQueue> queue;
+    linear::DeadlineQueue::Key key;
   };
   
  public:
@@ -51,10 +63,19 @@ class SocketImpl {
   inline linear::Socket::State GetState() { return state_; }
   inline const linear::Addrinfo& GetSelfInfo() { return self_; }
   inline const linear::Addrinfo& GetPeerInfo() { return peer_; }
+  size_t GetInFlightRequestCount();
+  linear::SocketMetrics GetMetrics();
+  size_t GetSendQueueSize();
 
   void SetMaxBufferSize(size_t limit);
   void SetMaxSendBufferSize(size_t limit);
   void SetMaxRecvBufferSize(size_t limit);
+  void SetSendBatchSize(size_t limit);
+  void SetPerSocketMsgid(bool enable);
+  void SetMethodInterning(bool enable);
+  void SetCompression(size_t threshold);
+  void SetSendWatermark(size_t high, size_t low);
+  void RecordConnectTime();
   linear::Error Connect(unsigned int timeout, linear::EventLoopImpl::SocketEvent* ev);
   linear::Error Disconnect(bool handshaking = false);
   linear::Error Send(const linear::Message& message, int timeout);
@@ -67,7 +88,9 @@ class SocketImpl {
   void OnHandshakeComplete(const shared_ptr<SocketImpl>& socket, tv_stream_t*, int status);
   void OnDisconnect(const shared_ptr<SocketImpl>& socket);
   void OnRead(const shared_ptr<SocketImpl>& socket, const tv_buf_t *buffer, ssize_t nread);
+  void OnWrite(const shared_ptr<SocketImpl>& socket, const linear::WriteBuffer* buffer, int status);
   void OnWrite(const shared_ptr<SocketImpl>& socket, const linear::Message* message, int status);
+  void OnResolve(const shared_ptr<SocketImpl>& socket, const std::vector<linear::Addrinfo>& addrs, int status);
   void OnConnectTimeout(const shared_ptr<SocketImpl>& socket);
   void OnRequestTimeout(const shared_ptr<SocketImpl>& socket, const linear::Request& request);
 
@@ -78,12 +101,25 @@ class SocketImpl {
   tv_stream_t* stream_;
   linear::EventLoopImpl::SocketEvent* ev_;
   linear::Addrinfo self_, peer_;
+  std::vector<linear::Addrinfo> addrs_; // resolved addresses of peer_, TCP only
+  size_t addr_index_;                   // address of addrs_ to connect now
   std::string bind_ifname_;
   linear::mutex state_mutex_;
   linear::shared_ptr<linear::EventLoopImpl> loop_;
 
  private:
   linear::Error _Send(linear::Message* ctx);
+  void _Dispatch(const shared_ptr<SocketImpl>& socket, const shared_ptr<HandlerDelegate>& delegate,
+                 msgpack::object_handle& handle);
+  void _AbortConnect(const linear::Error& err);
+  bool _ConnectNextAddress(tv_stream_t* stream);
+  void _CancelWrite(linear::WriteBuffer* buffer, size_t mark);
+  void _SendHello(const char* method, bool* sent);
+  void _Compress(linear::WriteBuffer* buffer, size_t mark, linear::PackedFrame* frame);
+  void _Decompress(const msgpack::object& obj, msgpack::object_handle* handle);
+  int64_t _InternMethod(const std::string& method, bool* define);
+  void _ConvertMethod(const msgpack::object& obj, std::string* method);
+  void _DequeueBytes(size_t bytes);
   void _SendPendingMessages(const shared_ptr<SocketImpl>& socket);
   void _DiscardMessages(const shared_ptr<SocketImpl>& socket);
 
@@ -91,15 +127,51 @@ class SocketImpl {
   int id_;
   bool connectable_;
   bool handshaking_;
+  bool resolving_;          // Connect is called but no stream is created, so ev_ is not owned by a stream
   linear::Error last_error_;
   linear::weak_ptr<linear::HandlerDelegate> delegate_;
   int connect_timeout_;
   linear::Timer connect_timer_;
   std::vector<linear::Message*> pending_messages_;
-  std::vector<linear::SocketImpl::RequestTimer*> request_timers_;
+  linear::unordered_map<uint32_t, linear::SocketImpl::RequestTimer*> request_timers_; // key: msgid
   linear::mutex request_timer_mutex_;
   size_t max_send_buffer_size_;
   size_t max_recv_buffer_size_;
+  linear::mutex send_mutex_;
+  size_t writing_;          // number of tv_write in flight
+  size_t send_batch_size_;
+  linear::WriteBuffer* batch_;
+  bool per_socket_msgid_;   // assign msgid from msgid_ instead of the process wide counter
+  uint32_t msgid_;          // guarded by state_mutex_
+  // counters of the send side are guarded by send_mutex_,
+  // and the ones of the receive side are updated atomically by the loop thread
+  linear::SocketMetrics metrics_;
+  volatile uint64_t recv_requests_;
+  volatile uint64_t recv_responses_;
+  volatile uint64_t recv_notifies_;
+  volatile uint64_t recv_bytes_;
+  volatile uint64_t decode_errors_;
+  uint64_t request_timeouts_; // guarded by request_timer_mutex_
+  uint64_t connect_start_;  // nsec, when Connect is called or the socket is accepted
+  size_t high_watermark_;   // 0: Send never returns LNR_EAGAIN
+  size_t low_watermark_;
+  bool wait_writable_;      // Send returned LNR_EAGAIN and OnWritable is not called yet
+  // method interning: methods are sent as ids once both of peers send INTERN_METHOD.
+  // an id is defined by sending [id, method] in place of method at first use.
+  bool method_interning_;   // guarded by state_mutex_
+  bool intern_hello_sent_;  // guarded by state_mutex_
+  bool peer_interning_;     // guarded by send_mutex_
+  linear::unordered_map<std::string, uint32_t> send_methods_; // guarded by send_mutex_
+  std::vector<std::string> recv_methods_; // index: id, used in the event loop thread only
+  // per-message compression: messages are compressed once both of peers send COMPRESS_METHOD.
+  // a compressed message is sent as a msgpack ext object in place of the message.
+  size_t compression_threshold_; // guarded by state_mutex_, 0: disabled
+  bool compress_hello_sent_;     // guarded by state_mutex_
+  bool peer_compression_;        // guarded by send_mutex_
+  volatile uint64_t recv_compressed_;
+  volatile uint64_t recv_compressed_bytes_;
+  volatile uint64_t recv_uncompressed_bytes_;
+  volatile uint64_t decompress_time_;
   msgpack::unpacker unpacker_;
 };
 
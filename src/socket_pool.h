@@ -6,6 +6,7 @@
 #include "linear/group.h"
 
 #include "socket_impl.h"
+#include "unordered.h"
 
 namespace linear {
 
@@ -33,14 +34,10 @@ class SocketPool {
 #endif
       return Error(LNR_ENOSPC);
     }
-    for (std::vector<linear::shared_ptr<linear::SocketImpl> >::iterator it = pool_.begin();
-         it != pool_.end(); it++) {
-      if (id == (*it)->GetId()) {
-        LINEAR_LOG(linear::log::LOG_WARN, "Socket(type = %d, id = %d) already exists", s->GetType(), id);
-        return Error(LNR_OK);
-      }
+    if (!pool_.insert(std::make_pair(id, s)).second) {
+      LINEAR_LOG(linear::log::LOG_WARN, "Socket(type = %d, id = %d) already exists", s->GetType(), id);
+      return Error(LNR_OK);
     }
-    pool_.push_back(s);
     LINEAR_DEBUG(linear::log::LOG_DEBUG, "Socket(type = %d, id = %d) is added", s->GetType(), id);
     return Error(LNR_OK);
   }
@@ -50,28 +47,35 @@ class SocketPool {
       return;
     }
     linear::lock_guard<linear::mutex> lock(mutex_);
-    for (std::vector<linear::shared_ptr<linear::SocketImpl> >::iterator it = pool_.begin();
-         it != pool_.end(); it++) {
-      if (id == (*it)->GetId()) {
-        LINEAR_DEBUG(linear::log::LOG_DEBUG, "Socket(type = %d, id = %d) is removed", s->GetType(), id);
-        pool_.erase(it);
-        return;
-      }
+    if (pool_.erase(id) > 0) {
+      LINEAR_DEBUG(linear::log::LOG_DEBUG, "Socket(type = %d, id = %d) is removed", s->GetType(), id);
+      return;
     }
     LINEAR_LOG(linear::log::LOG_WARN, "Socket(id = %d) is already removed", id);
   }
   void Clear() {
     linear::lock_guard<linear::mutex> lock(mutex_);
-    for (std::vector<linear::shared_ptr<linear::SocketImpl> >::iterator it = pool_.begin();
+    for (linear::unordered_map<int, linear::shared_ptr<linear::SocketImpl> >::iterator it = pool_.begin();
          it != pool_.end(); it++) {
-      linear::Group::LeaveAll(Socket(*it));
+      linear::Group::LeaveAll(Socket(it->second));
     }
     pool_.clear();
   }
+  // snapshot of sockets in the pool, sockets may be removed after return
+  std::vector<linear::Socket> GetAll() {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    std::vector<linear::Socket> sockets;
+    sockets.reserve(pool_.size());
+    for (linear::unordered_map<int, linear::shared_ptr<linear::SocketImpl> >::iterator it = pool_.begin();
+         it != pool_.end(); it++) {
+      sockets.push_back(Socket(it->second));
+    }
+    return sockets;
+  }
 
  protected:
   size_t max_;
-  std::vector<shared_ptr<linear::SocketImpl> > pool_;
+  linear::unordered_map<int, linear::shared_ptr<linear::SocketImpl> > pool_; // key: socket id
   linear::mutex mutex_;
 };
 
@@ -39,7 +39,13 @@ Error TCPSocketImpl::Connect() {
   stream_->data = ev_;
   std::ostringstream port_str;
   port_str << peer_.port;
-  ret = tv_connect(stream_, peer_.addr.c_str(), port_str.str().c_str(), EventLoopImpl::OnConnect);
+  // connect to the resolved address, so that tv_connect does not resolve host again
+  std::string addr = peer_.addr;
+  if (addr_index_ < addrs_.size()) {
+    addr = addrs_[addr_index_].addr;
+    peer_.proto = addrs_[addr_index_].proto;
+  }
+  ret = tv_connect(stream_, addr.c_str(), port_str.str().c_str(), EventLoopImpl::OnConnect);
   if (ret) {
     assert(false); // never reach now
     free(stream_);
@@ -3,18 +3,17 @@
 #include "linear/event_loop.h"
 #include "linear/log.h"
 
+#include "atomic.h"
 #include "timer_impl.h"
 
 using namespace linear::log;
 
 namespace linear {
 
-static mutex g_id_mutex;
+static volatile uint32_t g_id = 0;
 
 static int Id() {
-  lock_guard<mutex> lock(g_id_mutex);
-  static int id = 0;
-  return id++;
+  return static_cast<int>(AtomicFetchAndIncrement(&g_id) & 0x7fffffff);
 }
 
 TimerImpl::TimerImpl(const linear::EventLoop& loop)
@@ -0,0 +1,29 @@
+#ifndef LINEAR_UNORDERED_H_
+#define LINEAR_UNORDERED_H_
+
+#include "linear/memory.h"
+
+// hash containers come from the same library as shared_ptr (see memory.h)
+#ifdef HAVE_STD_SHARED_PTR
+# include <unordered_map>
+# include <unordered_set>
+#elif defined HAVE_TR1_SHARED_PTR
+# include <tr1/unordered_map>
+# include <tr1/unordered_set>
+#endif
+
+namespace linear {
+
+#ifdef HAVE_STD_SHARED_PTR
+using std::hash;
+using std::unordered_map;
+using std::unordered_set;
+#elif defined HAVE_TR1_SHARED_PTR
+using std::tr1::hash;
+using std::tr1::unordered_map;
+using std::tr1::unordered_set;
+#endif
+
+}  // namespace linear
+
+#endif  // LINEAR_UNORDERED_H_
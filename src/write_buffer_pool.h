@@ -0,0 +1,117 @@
+#ifndef LINEAR_WRITE_BUFFER_POOL_H_
+#define LINEAR_WRITE_BUFFER_POOL_H_
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "tv.h"
+
+#include "linear/memory.h"
+#include "linear/mutex.h"
+
+#define WRITE_BUFFER_POOL_SIZE (256)         // max number of idle buffers
+#define WRITE_BUFFER_INITIAL_SIZE (1024)
+#define WRITE_BUFFER_RETAIN_SIZE (64 * 1024) // bigger buffers are freed instead of being pooled
+
+namespace linear {
+
+class Message;
+class WriteBufferPool;
+
+// write request and the buffer written by it.
+// messages are packed straight into data, and the same memory is passed to tv_write.
+// several messages are packed one after another when writes are batched.
+struct WriteBuffer {
+  WriteBuffer() : data(NULL), size(0), capacity(0), messages() {
+    request.data = this;
+  }
+  ~WriteBuffer() {
+    free(data);
+  }
+  // stream interface for msgpack::packer
+  void write(const char* buf, size_t len) {
+    if (size + len > capacity) {
+      size_t next = (capacity == 0) ? WRITE_BUFFER_INITIAL_SIZE : capacity;
+      while (next < size + len) {
+        next *= 2;
+      }
+      char* p = static_cast<char*>(realloc(data, next));
+      if (p == NULL) {
+        throw std::bad_alloc();
+      }
+      data = p;
+      capacity = next;
+    }
+    memcpy(data + size, buf, len);
+    size += len;
+  }
+
+  tv_write_t request;
+  char* data;
+  size_t size;
+  size_t capacity;
+  std::vector<linear::Message*> messages;
+  linear::shared_ptr<linear::WriteBufferPool> pool;
+};
+
+class WriteBufferPool {
+ public:
+  WriteBufferPool() {
+  }
+  ~WriteBufferPool() {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    for (std::vector<linear::WriteBuffer*>::iterator it = pool_.begin(); it != pool_.end(); it++) {
+      delete *it;
+    }
+    pool_.clear();
+  }
+  // return NULL when out of memory
+  static linear::WriteBuffer* Acquire(const linear::shared_ptr<linear::WriteBufferPool>& pool) {
+    assert(pool);
+    linear::WriteBuffer* buffer = NULL;
+    linear::unique_lock<linear::mutex> lock(pool->mutex_);
+    if (!pool->pool_.empty()) {
+      buffer = pool->pool_.back();
+      pool->pool_.pop_back();
+      lock.unlock();
+    } else {
+      lock.unlock();
+      try {
+        buffer = new linear::WriteBuffer();
+      } catch(...) {
+        return NULL;
+      }
+    }
+    buffer->pool = pool;
+    return buffer;
+  }
+  // give the buffer back to the pool it was acquired from
+  static void Release(linear::WriteBuffer* buffer) {
+    linear::shared_ptr<linear::WriteBufferPool> pool;
+    pool.swap(buffer->pool);
+    buffer->size = 0;
+    buffer->messages.clear();
+    if (!pool || buffer->capacity > WRITE_BUFFER_RETAIN_SIZE) {
+      delete buffer;
+      return;
+    }
+    linear::unique_lock<linear::mutex> lock(pool->mutex_);
+    if (pool->pool_.size() >= WRITE_BUFFER_POOL_SIZE) {
+      lock.unlock();
+      delete buffer;
+      return;
+    }
+    pool->pool_.push_back(buffer);
+  }
+
+ private:
+  std::vector<linear::WriteBuffer*> pool_;
+  linear::mutex mutex_;
+};
+
+} // namespace linear
+
+#endif // LINEAR_WRITE_BUFFER_POOL_H_
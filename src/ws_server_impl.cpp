@@ -13,7 +13,7 @@ namespace linear {
 WSServerImpl::WSServerImpl(const weak_ptr<Handler>& handler,
                            AuthContext::Type auth_type, const std::string& realm,
                            const EventLoop& loop)
-  : ServerImpl(handler, loop),
+  : ServerImpl(handler, loop), nonce_pool_(loop_),
     auth_type_(auth_type), realm_(realm), handle_(NULL) {
 }
 
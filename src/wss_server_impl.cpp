@@ -15,7 +15,7 @@ WSSServerImpl::WSSServerImpl(const weak_ptr<Handler>& handler,
                              AuthContext::Type auth_type,
                              const std::string& realm,
                              const EventLoop& loop)
-  : ServerImpl(handler, loop, true),
+  : ServerImpl(handler, loop, true), nonce_pool_(loop_),
     auth_type_(auth_type), realm_(realm), ssl_context_(ssl_context), handle_(NULL) {
 }
 
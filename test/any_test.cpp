@@ -392,6 +392,42 @@ TEST(AnyTest, ext) {
   }
 }
 
+TEST(AnyTest, sharedZone) {
+  {
+    std::vector<std::string> v;
+    v.push_back("abc");
+    v.push_back("def");
+    linear::type::any a1(v);
+    linear::type::any a2(a1);
+    EXPECT_EQ(&a1.zone(), &a2.zone());
+    EXPECT_EQ(a1.object().via.array.ptr, a2.object().via.array.ptr);
+    linear::type::any a3;
+    a3 = a1;
+    EXPECT_EQ(&a1.zone(), &a3.zone());
+
+    a2 = std::string("ghi");
+    EXPECT_NE(&a1.zone(), &a2.zone());
+    EXPECT_EQ(linear::type::any::ARRAY, a1.type);
+    EXPECT_EQ(v, a1.as<std::vector<std::string> >());
+    EXPECT_EQ(v, a3.as<std::vector<std::string> >());
+    EXPECT_EQ(std::string("ghi"), a2.as<std::string>());
+  }
+  {
+    linear::shared_ptr<msgpack::zone> zone(new msgpack::zone());
+    msgpack::object o(std::string("abc"), *zone);
+    linear::type::any a1(o, zone);
+    EXPECT_EQ(zone.get(), &a1.zone());
+    EXPECT_EQ(o.via.str.ptr, a1.object().via.str.ptr);
+    zone.reset();
+    linear::type::any a2(a1);
+    EXPECT_EQ(std::string("abc"), a2.as<std::string>());
+    linear::type::any a3(a2.object());
+    EXPECT_NE(&a2.zone(), &a3.zone());
+    EXPECT_NE(a2.object().via.str.ptr, a3.object().via.str.ptr);
+    EXPECT_EQ(std::string("abc"), a3.as<std::string>());
+  }
+}
+
 int main(int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
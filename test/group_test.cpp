@@ -0,0 +1,89 @@
+#include "test_common.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "linear/tcp_client.h"
+
+using namespace linear;
+
+typedef LinearTest GroupTest;
+
+static std::string GroupName(int i) {
+  std::ostringstream os;
+  os << GROUP_NAME << i;
+  return os.str();
+}
+
+TEST_F(GroupTest, JoinLeaveAll) {
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket s1 = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+  TCPSocket s2 = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Group::Join(GroupName(0), s1);
+  Group::Join(GroupName(1), s1);
+  Group::Join(GroupName(1), s2);
+  ASSERT_EQ(1, Group::Members(GroupName(0))->size());
+  ASSERT_EQ(2, Group::Members(GroupName(1))->size());
+
+  shared_ptr<const std::set<Socket> > members = Group::Members(GroupName(1));
+  Group::LeaveAll(s1);
+  ASSERT_EQ(0, Group::Members(GroupName(0))->size());
+  ASSERT_EQ(1, Group::Members(GroupName(1))->size());
+  ASSERT_EQ(1, Group::Members(GroupName(1))->count(s2));
+  ASSERT_EQ(2, members->size()); // a snapshot taken before LeaveAll is not changed
+
+  Group::LeaveAll(s1); // no more groups
+  Group::Leave(GroupName(1), s2);
+  ASSERT_EQ(0, Group::Members(GroupName(1))->size());
+  std::vector<std::string> names = Group::Names();
+  ASSERT_TRUE(std::find(names.begin(), names.end(), GroupName(1)) == names.end());
+}
+
+#ifndef _WIN32
+#define GROUP_TEST_GROUPS (64)
+#define GROUP_TEST_LOOPS  (100)
+
+static void* JoinLeaveRepeatedly(void* param) {
+  const Socket* socket = reinterpret_cast<const Socket*>(param);
+  for (int i = 0; i < GROUP_TEST_LOOPS; i++) {
+    for (int j = 0; j < GROUP_TEST_GROUPS; j++) {
+      Group::Join(GroupName(j), *socket);
+      if (j % 2) {
+        Group::Leave(GroupName(j), *socket);
+      }
+    }
+  }
+  return NULL;
+}
+
+static void* LeaveAllRepeatedly(void* param) {
+  const Socket* socket = reinterpret_cast<const Socket*>(param);
+  for (int i = 0; i < GROUP_TEST_LOOPS; i++) {
+    Group::LeaveAll(*socket);
+  }
+  return NULL;
+}
+
+// a group joined while LeaveAll is running must be left by the next LeaveAll
+TEST_F(GroupTest, JoinLeaveAllFromOtherThreads) {
+  linear::log::SetLevel(linear::log::LOG_OFF);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  Socket s = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  pthread_t joiners[2], leaver;
+  ASSERT_EQ(0, pthread_create(&joiners[0], NULL, JoinLeaveRepeatedly, &s));
+  ASSERT_EQ(0, pthread_create(&joiners[1], NULL, JoinLeaveRepeatedly, &s));
+  ASSERT_EQ(0, pthread_create(&leaver, NULL, LeaveAllRepeatedly, &s));
+  pthread_join(joiners[0], NULL);
+  pthread_join(joiners[1], NULL);
+  pthread_join(leaver, NULL);
+
+  Group::LeaveAll(s);
+  for (int j = 0; j < GROUP_TEST_GROUPS; j++) {
+    ASSERT_EQ(0, Group::Members(GroupName(j))->count(s)) << GroupName(j);
+  }
+}
+#endif
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "linear/log.h"
+
+using namespace linear::log;
+
+class LinearLogAsyncTest : public testing::Test {
+protected:
+  LinearLogAsyncTest() {}
+  ~LinearLogAsyncTest() {}
+  virtual void SetUp() {}
+  virtual void TearDown() {}
+};
+
+static size_t CountLines(const std::string& filename) {
+  std::ifstream ifs(filename.c_str());
+  std::string line;
+  size_t n = 0;
+  while (std::getline(ifs, line)) {
+    n++;
+  }
+  return n;
+}
+
+TEST_F(LinearLogAsyncTest, showValidLog) {
+  std::string TEST_DISPLAY("DISPLAY"), TEST_HIDE("HIDE");
+
+  ASSERT_EQ(true, linear::log::EnableFile("./test.log"));
+  ASSERT_EQ(true, linear::log::EnableAsync(16, LOG_OVERFLOW_BLOCK));
+  linear::log::SetLevel(LOG_WARN);
+
+  for (int i = 0; i < 1000; i++) {
+    LINEAR_LOG(LOG_ERR, "%s", TEST_DISPLAY.c_str());
+    LINEAR_LOG(LOG_INFO, "%s", TEST_HIDE.c_str());
+  }
+  linear::log::DisableAsync();
+  linear::log::DisableFile();
+  ASSERT_EQ(0u, linear::log::GetDroppedCount());
+}
+
+TEST_F(LinearLogAsyncTest, dropWhenFull) {
+  ASSERT_EQ(true, linear::log::EnableFile("./test_drop.log"));
+  ASSERT_EQ(true, linear::log::EnableAsync(4, LOG_OVERFLOW_DROP));
+  linear::log::SetLevel(LOG_ERR);
+
+  size_t before = linear::log::GetDroppedCount();
+  for (int i = 0; i < 1000; i++) {
+    LINEAR_LOG(LOG_ERR, "DROP");
+  }
+  linear::log::DisableAsync();
+  linear::log::DisableFile();
+  size_t dropped = linear::log::GetDroppedCount() - before;
+  ASSERT_EQ(1000u, CountLines("./test_drop.log") + dropped);
+  remove("./test_drop.log");
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
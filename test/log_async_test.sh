@@ -0,0 +1,23 @@
+#!/bin/sh
+
+test_log_file="./test.log"
+rm -f ${test_log_file}
+./log_async_test || exit 1
+
+count() {
+    word=$1
+    cat ${test_log_file} | tr [:blank:] "\n" | grep ${word} | wc -l
+}
+
+disp=`count DISPLAY`
+hide=`count HIDE`
+err=`count ERR`
+inf=`count INF`
+
+if [ ${disp} -ne 1000 -o ${hide} -ne 0 -o ${err} -ne 1000 -o ${inf} -ne 0 ]; then
+    echo "invalid output"
+    echo "disp = ${disp}, hide = ${hide}, err = ${err}, info = ${inf}"
+    exit 1
+fi
+rm -f ${test_log_file}
+exit 0
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "linear/any.h"
+#include "linear/log.h"
+
+using namespace linear::log;
+
+class LinearLogBinaryTest : public testing::Test {
+protected:
+  LinearLogBinaryTest() {}
+  ~LinearLogBinaryTest() {}
+  virtual void SetUp() {}
+  virtual void TearDown() {}
+};
+
+TEST_F(LinearLogBinaryTest, showValidLog) {
+  std::string TEST_DISPLAY("DISPLAY"), TEST_HIDE("HIDE");
+
+  ASSERT_EQ(true, linear::log::EnableBinaryFile("./test.bin"));
+  linear::log::SetLevel(LOG_WARN);
+
+  for (int i = 0; i < 3; i++) {
+    LINEAR_LOG(LOG_ERR, "%s int=%d uint=%u size=%zu long=%ld neg=%lld hex=%#x dbl=%.2f str=%-5s| %%",
+               TEST_DISPLAY.c_str(), -1, 2u, static_cast<size_t>(3), 4L, -5LL, 255, 1.5, "ab");
+  }
+  LINEAR_LOG(LOG_WARN, "%*d|%.*s|%c", 4, 7, 3, "DISPLAYED", 'Z');
+  // msgpack bytes are recorded, and rendered by the decoder
+  std::vector<int> values;
+  values.push_back(1);
+  values.push_back(2);
+  linear::type::any params(values);
+  LINEAR_LOG(LOG_ERR, "%s params=%s", TEST_DISPLAY.c_str(), LINEAR_LOG_PRINTABLE_STRING(params).c_str());
+  LINEAR_LOG(LOG_INFO, "%s", TEST_HIDE.c_str());
+  LINEAR_LOG(LOG_DEBUG, "%s", TEST_HIDE.c_str());
+  linear::log::DisableBinaryFile();
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,28 @@
+#!/bin/sh
+
+test_bin_file="./test.bin"
+test_log_file="./test.log"
+rm -f ${test_bin_file} ${test_log_file}
+./log_binary_test || exit 1
+../tools/linear_logdecode ${test_bin_file} > ${test_log_file} || exit 1
+
+count() {
+    word=$1
+    cat ${test_log_file} | grep -e "${word}" | wc -l
+}
+
+disp=`count DISPLAY`
+hide=`count HIDE`
+args=`count "DISPLAY int=-1 uint=2 size=3 long=4 neg=-5 hex=0xff dbl=1.50 str=ab   | %$"`
+stars=`count "   7|DIS|Z$"`
+params=`count "DISPLAY params=\[1, 2\]$"`
+err=`count "\[ERR\]"`
+warn=`count "\[WRN\]"`
+
+if [ ${disp} -ne 4 -o ${hide} -ne 0 -o ${args} -ne 3 -o ${stars} -ne 1 -o ${params} -ne 1 -o ${err} -ne 4 -o ${warn} -ne 1 ]; then
+    echo "invalid output"
+    echo "disp = ${disp}, hide = ${hide}, args = ${args}, stars = ${stars}, params = ${params}, err = ${err}, warn = ${warn}"
+    exit 1
+fi
+rm -f ${test_bin_file} ${test_log_file}
+exit 0
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#include <string>
+
+#include "linear/log.h"
+
+using namespace linear::log;
+
+class LinearLogRotateTest : public testing::Test {
+protected:
+  LinearLogRotateTest() {}
+  ~LinearLogRotateTest() {}
+  virtual void SetUp() {
+    Cleanup();
+  }
+  virtual void TearDown() {
+    Cleanup();
+  }
+  void Cleanup() {
+    remove("./test_rotate.log");
+    remove("./test_rotate.log.1");
+    remove("./test_rotate.log.2");
+    remove("./test_rotate.log.3");
+    remove("./test_rotate.log.next");
+  }
+};
+
+static bool Exists(const char* filename) {
+  FILE* fp = fopen(filename, "r");
+  if (fp == NULL) {
+    return false;
+  }
+  fclose(fp);
+  return true;
+}
+
+TEST_F(LinearLogRotateTest, rotateBySize) {
+  ASSERT_EQ(true, linear::log::EnableFile("./test_rotate.log", 1024, 0, 2));
+  linear::log::SetLevel(LOG_ERR);
+
+  for (int i = 0; i < 1000; i++) {
+    LINEAR_LOG(LOG_ERR, "ROTATE %d", i);
+  }
+  linear::log::DisableFile();
+
+  ASSERT_TRUE(Exists("./test_rotate.log"));
+  ASSERT_TRUE(Exists("./test_rotate.log.1"));
+  ASSERT_FALSE(Exists("./test_rotate.log.3"));
+  ASSERT_FALSE(Exists("./test_rotate.log.next"));
+}
+
+TEST_F(LinearLogRotateTest, appendWithoutTruncate) {
+  ASSERT_EQ(true, linear::log::EnableFile("./test_rotate.log", 1024 * 1024, 0, 2));
+  linear::log::SetLevel(LOG_ERR);
+  LINEAR_LOG(LOG_ERR, "FIRST");
+  linear::log::DisableFile();
+
+  ASSERT_EQ(true, linear::log::EnableFile("./test_rotate.log", 1024 * 1024, 0, 2));
+  LINEAR_LOG(LOG_ERR, "SECOND");
+  linear::log::DisableFile();
+
+  FILE* fp = fopen("./test_rotate.log", "r");
+  ASSERT_TRUE(fp != NULL);
+  char line[256];
+  int n = 0;
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    n++;
+  }
+  fclose(fp);
+  ASSERT_EQ(2, n);
+}
+
+// plain EnableFile after a rotating one stops rotating
+TEST_F(LinearLogRotateTest, enableWithoutRotate) {
+  ASSERT_EQ(true, linear::log::EnableFile("./test_rotate.log", 1024, 0, 2));
+  linear::log::SetLevel(LOG_ERR);
+  LINEAR_LOG(LOG_ERR, "ROTATE");
+
+  ASSERT_EQ(true, linear::log::EnableFile("./test_rotate.log"));
+  ASSERT_FALSE(Exists("./test_rotate.log.next"));
+  for (int i = 0; i < 1000; i++) {
+    LINEAR_LOG(LOG_ERR, "NO ROTATE %d", i);
+  }
+  linear::log::DisableFile();
+
+  ASSERT_FALSE(Exists("./test_rotate.log.1"));
+  FILE* fp = fopen("./test_rotate.log", "r");
+  ASSERT_TRUE(fp != NULL);
+  char line[256];
+  int n = 0;
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    n++;
+  }
+  fclose(fp);
+  ASSERT_EQ(1000, n);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,55 @@
+#include "test_common.h"
+
+#include <sstream>
+
+#include "linear/event_loop.h"
+
+#include "nonce_pool.h"
+
+using namespace linear;
+
+typedef LinearTest NoncePoolTest;
+
+static std::string MakeNonce(int i) {
+  std::ostringstream os;
+  os << "0123456789abcdef" << i; // first 16 chars are not logged
+  return os.str();
+}
+
+TEST_F(NoncePoolTest, AddRemove) {
+  EventLoop loop;
+  NoncePool pool(loop.GetImpl());
+
+  ASSERT_EQ(LNR_OK, pool.Add(MakeNonce(0)).Code());
+  ASSERT_EQ(LNR_EALREADY, pool.Add(MakeNonce(0)).Code());
+  ASSERT_TRUE(pool.IsValid(MakeNonce(0)));
+  ASSERT_FALSE(pool.IsValid(MakeNonce(1)));
+  ASSERT_EQ(1u, loop.GetImpl()->GetDeadlineQueue()->Size());
+
+  pool.Remove(MakeNonce(0));
+  pool.Remove(MakeNonce(1)); // not added
+  ASSERT_FALSE(pool.IsValid(MakeNonce(0)));
+  ASSERT_EQ(0u, loop.GetImpl()->GetDeadlineQueue()->Size());
+}
+
+// many nonces expire by the deadline queue of the loop, without a timer for each
+TEST_F(NoncePoolTest, Expire) {
+  EventLoop loop;
+  {
+    NoncePool pool(loop.GetImpl());
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_EQ(LNR_OK, pool.Add(MakeNonce(i), 100).Code());
+    }
+    ASSERT_EQ(LNR_OK, pool.Add(MakeNonce(1000)).Code());
+    ASSERT_EQ(1001u, loop.GetImpl()->GetDeadlineQueue()->Size());
+
+    msleep(500);
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_FALSE(pool.IsValid(MakeNonce(i))) << MakeNonce(i);
+    }
+    ASSERT_TRUE(pool.IsValid(MakeNonce(1000)));
+    ASSERT_EQ(1u, loop.GetImpl()->GetDeadlineQueue()->Size());
+  }
+  // nonces left in the pool are removed from the queue with the pool
+  ASSERT_EQ(0u, loop.GetImpl()->GetDeadlineQueue()->Size());
+}
@@ -177,6 +177,52 @@ TEST_F(TCPClientServerConnectionTest, DisconnectFromClientFT) {
   WAIT_DISCONNECTED();
 }
 
+// Server enumerates connected sockets
+TEST_F(TCPClientServerConnectionTest, GetSockets) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+  ASSERT_TRUE(sv.GetSockets().empty());
+
+  EXPECT_CALL(*sh, OnConnectMock(_))
+    .WillOnce(Assign(&srv_connected, true));
+  EXPECT_CALL(*sh, OnDisconnectMock(Eq(ByRef(sh->s_)), Error(LNR_EOF)))
+    .WillOnce(Assign(&srv_connected, false));
+  EXPECT_CALL(*ch, OnConnectMock(cs))
+    .WillOnce(Assign(&cli_connected, true));
+  EXPECT_CALL(*ch, OnDisconnectMock(cs, Error(LNR_OK)))
+    .WillOnce(Assign(&cli_connected, false));
+
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_CONNECTED();
+
+  std::vector<Socket> sockets = sv.GetSockets();
+  ASSERT_EQ(1u, sockets.size());
+  ASSERT_EQ(sh->s_, sockets[0]);
+  sockets.clear();
+
+  e = cs.Disconnect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_DISCONNECTED();
+  for (int i = 0; i < 10 && !sv.GetSockets().empty(); i++) {
+    msleep(100);
+  }
+  ASSERT_TRUE(sv.GetSockets().empty());
+}
+
 // Connect - Disconnect from Server in front thread
 TEST_F(TCPClientServerConnectionTest, DisconnectFromServerFT) {
   shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
@@ -673,3 +719,72 @@ TEST_F(TCPClientServerConnectionTest, IPv6) {
   ASSERT_EQ(LNR_OK, e.Code());
   WAIT_TESTED();
 }
+
+// Connect - host name, tried with every resolved address
+TEST_F(TCPClientServerConnectionTest, ConnectHostName) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket("localhost", TEST_PORT);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  EXPECT_CALL(*sh, OnConnectMock(_))
+    .WillOnce(Assign(&srv_connected, true));
+  EXPECT_CALL(*ch, OnConnectMock(cs))
+    .WillOnce(Assign(&cli_connected, true));
+
+  e = cs.Connect(1000);
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_CONNECTED();
+  ASSERT_EQ(Addrinfo::IPv4, cs.GetPeerInfo().proto);
+}
+
+// Connect - host name not resolvable
+TEST_F(TCPClientServerConnectionTest, ConnectUnresolvable) {
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket("unresolvable.invalid", TEST_PORT);
+  Error err;
+
+  EXPECT_CALL(*ch, OnConnectMock(_))
+    .Times(0);
+  EXPECT_CALL(*ch, OnDisconnectMock(cs, _))
+    .WillOnce(DoAll(::testing::SaveArg<1>(&err), Assign(&cli_tested, true)));
+
+  Error e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_CLI_TESTED();
+  ASSERT_NE(LNR_OK, err.Code());
+
+  // the failure is cached, and Connect returns it without resolving again
+  e = cs.Connect();
+  ASSERT_EQ(err.Code(), e.Code());
+}
+
+// Cancel - while resolving host name
+TEST_F(TCPClientServerConnectionTest, ConnectCancelResolving) {
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket("cancel.invalid", TEST_PORT);
+
+  EXPECT_CALL(*ch, OnConnectMock(_))
+    .Times(0);
+  EXPECT_CALL(*ch, OnDisconnectMock(cs, _))
+    .WillOnce(Assign(&cli_tested, true));
+
+  Error e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  cs.Disconnect(); // EALREADY when the lookup has already failed
+  WAIT_CLI_TESTED();
+  ASSERT_EQ(Socket::DISCONNECTED, cs.GetState());
+}
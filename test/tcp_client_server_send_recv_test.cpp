@@ -1,5 +1,6 @@
 #include "test_common.h"
 
+#include "linear/router.h"
 #include "linear/tcp_client.h"
 #include "linear/tcp_server.h"
 
@@ -13,7 +14,63 @@ using ::testing::Eq;
 using ::testing::ByRef;
 using ::testing::Assign;
 
-typedef LinearTest TCPClientServerSendRecvTest;
+// a server and a client socket to it, with mock handlers of both sides
+struct TCPPeers {
+  TCPPeers(const std::string& host = TEST_ADDR)
+    : sh(new MockHandler()), sv(sh), ch(new MockHandler()), cl(ch), cs(cl.CreateSocket(host, TEST_PORT)) {}
+  shared_ptr<MockHandler> sh;
+  TCPServer sv;
+  shared_ptr<MockHandler> ch;
+  TCPClient cl;
+  TCPSocket cs;
+};
+
+class TCPClientServerSendRecvTest : public LinearTest {
+ protected:
+  // start the server, and retry while the port is not released by the previous test yet
+  Error StartServer(const TCPServer& server) {
+    Error e;
+    for (int i = 0; i < 3; i++) {
+      e = server.Start(TEST_ADDR, TEST_PORT);
+      if (e == linear::Error(LNR_OK)) {
+        break;
+      }
+      msleep(100);
+    }
+    return e;
+  }
+  // expect both sides to be connected once
+  void ExpectConnected(const TCPPeers& p) {
+    EXPECT_CALL(*p.sh, OnConnectMock(_))
+      .WillOnce(Assign(&srv_connected, true));
+    EXPECT_CALL(*p.ch, OnConnectMock(p.cs))
+      .WillOnce(Assign(&cli_connected, true));
+  }
+  // expect both sides to be disconnected once at the end of the test
+  void ExpectDisconnected(const TCPPeers& p) {
+    EXPECT_CALL(*p.sh, OnDisconnectMock(_, _))
+      .WillOnce(Assign(&srv_tested, true));
+    EXPECT_CALL(*p.ch, OnDisconnectMock(p.cs, _))
+      .WillOnce(Assign(&cli_tested, true));
+  }
+  // connect the client socket, and wait for both sides to be connected
+  Error ConnectAndWait(const TCPPeers& p) {
+    Error e = p.cs.Connect();
+    if (e == linear::Error(LNR_OK)) {
+      WAIT_CONNECTED();
+    }
+    return e;
+  }
+};
+
+static int AddInts(const Socket&, const std::vector<int>& params) {
+  return params[0] + params[1];
+}
+ACTION_P(CheckResult, expected) {
+  const linear::Message& m = arg1;
+  linear::Response response = m.as<linear::Response>();
+  ASSERT_EQ(expected, response.result.as<int>());
+}
 
 // Send Request from Client in front thread and Send Response from Server in back thread
 TEST_F(TCPClientServerSendRecvTest, RequestFromClientFTResponseFromServerBT) {
@@ -409,6 +466,32 @@ TEST_F(TCPClientServerSendRecvTest, CancelRequestWithDisconnectedFromClientFT) {
   ASSERT_EQ(req.params, err_req.params);
 }
 
+// Count Requests waiting for Response
+TEST_F(TCPClientServerSendRecvTest, InFlightRequestCount) {
+  TCPPeers p;
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  ExpectConnected(p);
+  EXPECT_CALL(*p.sh, OnMessageMock(Eq(ByRef(p.sh->s_)), _))
+    .Times(::testing::AtLeast(0));
+  EXPECT_CALL(*p.ch, OnErrorMock(p.cs, _, Error(LNR_ECANCELED)))
+    .Times(3);
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(0U, p.cs.GetInFlightRequestCount());
+  ASSERT_EQ(LNR_OK, ConnectAndWait(p).Code());
+
+  for (int i = 0; i < 3; i++) {
+    Request req(std::string(METHOD_NAME), Params());
+    Error e = req.Send(p.cs);
+    ASSERT_EQ(LNR_OK, e.Code());
+  }
+  ASSERT_EQ(3U, p.cs.GetInFlightRequestCount());
+  p.cs.Disconnect();
+  WAIT_TESTED();
+  ASSERT_EQ(0U, p.cs.GetInFlightRequestCount());
+}
+
 // Send Notify from Client in front thread
 TEST_F(TCPClientServerSendRecvTest, NotifyFromClientFT) {
   shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
@@ -879,3 +962,544 @@ TEST_F(TCPClientServerSendRecvTest, NotOverflowSendBuffer) {
   WAIT_CONNECTED();
   WAIT_TESTED();
 }
+
+// Notifies sent while a write is in progress are batched, and every one must arrive
+TEST_F(TCPClientServerSendRecvTest, BatchedNotify) {
+  TCPPeers p;
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  EXPECT_CALL(*p.sh, OnConnectMock(_))
+    .WillOnce(WithArg<0>(MultiSendNotify(100, 0)));
+  EXPECT_CALL(*p.sh, OnErrorMock(_, _, _))
+    .Times(0);
+  EXPECT_CALL(*p.ch, OnConnectMock(p.cs));
+  {
+    InSequence dummy;
+    EXPECT_CALL(*p.ch, OnMessageMock(_, _))
+      .Times(99);
+    EXPECT_CALL(*p.ch, OnMessageMock(_, _))
+      .WillOnce(WithArg<0>(Disconnect()));
+  }
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(LNR_OK, p.cs.Connect().Code());
+  WAIT_TESTED();
+}
+
+// Requests sent through a socket with its own msgid space are numbered from 1
+TEST_F(TCPClientServerSendRecvTest, PerSocketMsgid) {
+  TCPPeers p;
+  ASSERT_EQ(LNR_OK, p.cs.SetPerSocketMsgid(true).Code());
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  ExpectConnected(p);
+  EXPECT_CALL(*p.sh, OnMessageMock(Eq(ByRef(p.sh->s_)), _))
+    .WillOnce(WithArgs<0, 1>(SendResponse()));
+  EXPECT_CALL(*p.ch, OnMessageMock(p.cs, _))
+    .WillOnce(WithArgs<0>(Disconnect()));
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(LNR_OK, ConnectAndWait(p).Code());
+  Request req(std::string(METHOD_NAME), Params());
+  ASSERT_EQ(LNR_OK, req.Send(p.cs).Code());
+
+  WAIT_TESTED();
+
+  // check message in server side
+  ASSERT_TRUE(p.sh->m_ != NULL);
+  ASSERT_EQ(REQUEST, p.sh->m_->type);
+  Request recv_req = p.sh->m_->as<Request>();
+  ASSERT_EQ(1u, recv_req.msgid);
+  // check message in client side
+  ASSERT_TRUE(p.ch->m_ != NULL);
+  ASSERT_EQ(RESPONSE, p.ch->m_->type);
+  Response resp = p.ch->m_->as<Response>();
+  ASSERT_EQ(1u, resp.msgid);
+  ASSERT_EQ(1u, resp.request.msgid);
+}
+
+// Send returns LNR_EAGAIN over the high watermark, and OnWritable is called when the queue is drained
+TEST_F(TCPClientServerSendRecvTest, SendWatermark) {
+  TCPPeers p;
+  ASSERT_EQ(LNR_EINVAL, p.cs.SetSendWatermark(1, 2).Code());
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  EXPECT_CALL(*p.sh, OnConnectMock(_))
+    .WillOnce(WithArg<0>(SendUntilWouldBlock(20000, 0)));
+  EXPECT_CALL(*p.sh, OnErrorMock(_, _, _))
+    .Times(0);
+  EXPECT_CALL(*p.sh, OnWritableMock(_))
+    .WillOnce(WithArg<0>(Disconnect()));
+  EXPECT_CALL(*p.ch, OnConnectMock(p.cs));
+  EXPECT_CALL(*p.ch, OnMessageMock(_, _))
+    .Times(::testing::AtLeast(1));
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(LNR_OK, p.cs.Connect().Code());
+  WAIT_TESTED();
+}
+
+// Counters of a socket are kept after it is disconnected
+TEST_F(TCPClientServerSendRecvTest, Metrics) {
+  TCPPeers p;
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  ExpectConnected(p);
+  EXPECT_CALL(*p.sh, OnMessageMock(Eq(ByRef(p.sh->s_)), _))
+    .WillOnce(WithArgs<0, 1>(SendResponse()));
+  EXPECT_CALL(*p.ch, OnMessageMock(p.cs, _))
+    .WillOnce(WithArgs<0>(Disconnect()));
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(LNR_OK, ConnectAndWait(p).Code());
+  Request req(std::string(METHOD_NAME), Params());
+  ASSERT_EQ(LNR_OK, req.Send(p.cs).Code());
+
+  WAIT_TESTED();
+
+  SocketMetrics m = p.cs.GetMetrics();
+  ASSERT_EQ(1u, m.sent_requests);
+  ASSERT_EQ(0u, m.sent_responses);
+  ASSERT_EQ(0u, m.sent_notifies);
+  ASSERT_LT(0u, m.sent_bytes);
+  ASSERT_EQ(0u, m.recv_requests);
+  ASSERT_EQ(1u, m.recv_responses);
+  ASSERT_LT(0u, m.recv_bytes);
+  ASSERT_EQ(0u, m.send_queue_size);
+  ASSERT_EQ(0u, m.pending_requests);
+  ASSERT_EQ(0u, m.request_timeouts);
+  ASSERT_EQ(0u, m.decode_errors);
+}
+
+// Handlers called in workers of a dispatcher receive messages of a socket in order
+TEST_F(TCPClientServerSendRecvTest, Dispatcher) {
+  Dispatcher dispatcher(2);
+  TCPPeers p;
+  ASSERT_EQ(LNR_OK, p.sv.SetDispatcher(dispatcher).Code());
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  ExpectConnected(p);
+  EXPECT_CALL(*p.sh, OnErrorMock(_, _, _))
+    .Times(0);
+  {
+    InSequence dummy;
+    EXPECT_CALL(*p.sh, OnMessageMock(_, _))
+      .Times(99);
+    EXPECT_CALL(*p.sh, OnMessageMock(_, _))
+      .WillOnce(WithArg<0>(Disconnect()));
+  }
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(LNR_OK, ConnectAndWait(p).Code());
+  for (int i = 0; i < 100; i++) {
+    Notify notify(std::string(METHOD_NAME), i);
+    ASSERT_EQ(LNR_OK, notify.Send(p.cs).Code());
+  }
+
+  WAIT_TESTED();
+
+  // the last message must be the last one sent
+  ASSERT_TRUE(p.sh->m_ != NULL);
+  ASSERT_EQ(NOTIFY, p.sh->m_->type);
+  Notify recv_notif = p.sh->m_->as<Notify>();
+  Notify last(std::string(METHOD_NAME), 99);
+  ASSERT_EQ(last.params, recv_notif.params);
+}
+
+ACTION_P(DeleteClient, client) {
+  delete client;
+}
+
+// A dispatcher whose last reference is dropped in its worker does not join the worker itself
+TEST_F(TCPClientServerSendRecvTest, DispatcherDestroyedInWorker) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient* cl = new TCPClient(ch);
+  {
+    Dispatcher dispatcher(2);
+    ASSERT_EQ(LNR_OK, cl->SetDispatcher(dispatcher).Code());
+  } // only the client refers to the dispatcher
+  TCPSocket cs = cl->CreateSocket(TEST_ADDR, TEST_PORT);
+
+  ASSERT_EQ(LNR_OK, StartServer(sv).Code());
+
+  EXPECT_CALL(*sh, OnConnectMock(_))
+    .WillOnce(WithArg<0>(Disconnect()));
+  EXPECT_CALL(*sh, OnDisconnectMock(_, _))
+    .WillOnce(Assign(&srv_tested, true));
+  EXPECT_CALL(*ch, OnConnectMock(cs));
+  EXPECT_CALL(*ch, OnDisconnectMock(cs, _))
+    .WillOnce(DoAll(DeleteClient(cl), Assign(&cli_tested, true)));
+
+  ASSERT_EQ(LNR_OK, cs.Connect().Code());
+
+  WAIT_TESTED();
+}
+
+// Router sends the result of the registered function, and an error for unknown methods
+TEST_F(TCPClientServerSendRecvTest, Router) {
+  shared_ptr<Router> sh = linear::shared_ptr<Router>(new Router());
+  sh->AddRequest("add", AddInts);
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  ASSERT_EQ(LNR_OK, StartServer(sv).Code());
+
+  {
+    InSequence dummy;
+    EXPECT_CALL(*ch, OnConnectMock(cs));
+    EXPECT_CALL(*ch, OnMessageMock(cs, _))
+      .WillOnce(DoAll(CheckResult(3), WithArg<0>(SendRequest())));
+    EXPECT_CALL(*ch, OnMessageMock(cs, _))
+      .WillOnce(WithArg<0>(Disconnect()));
+    EXPECT_CALL(*ch, OnDisconnectMock(_, _))
+      .WillOnce(Assign(&cli_tested, true));
+  }
+
+  ASSERT_EQ(LNR_OK, cs.Connect().Code());
+  std::vector<int> params;
+  params.push_back(1);
+  params.push_back(2);
+  Request req("add", params);
+  ASSERT_EQ(LNR_OK, req.Send(cs).Code());
+
+  WAIT_CLI_TESTED();
+
+  // check the response of unknown method
+  ASSERT_TRUE(ch->m_ != NULL);
+  ASSERT_EQ(RESPONSE, ch->m_->type);
+  Response resp = ch->m_->as<Response>();
+  ASSERT_TRUE(resp.result.is_nil());
+  ASSERT_EQ(std::string("method not found"), resp.error.as<std::string>());
+}
+
+// Methods are sent as ids after both of peers enable method interning, and handlers receive them as strings
+TEST_F(TCPClientServerSendRecvTest, MethodInterning) {
+  TCPPeers p;
+  ASSERT_EQ(LNR_OK, p.cs.SetMethodInterning(true).Code());
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  EXPECT_CALL(*p.sh, OnConnectMock(_))
+    .WillOnce(WithArg<0>(EnableMethodInterning()));
+  // the notify to enable method interning is not passed to handlers
+  EXPECT_CALL(*p.sh, OnMessageMock(Eq(ByRef(p.sh->s_)), _))
+    .Times(3)
+    .WillRepeatedly(WithArgs<0, 1>(SendResponse()));
+  EXPECT_CALL(*p.ch, OnConnectMock(p.cs));
+  {
+    InSequence dummy;
+    // 1st: method as a string, 2nd: definition of the id, 3rd: the id
+    EXPECT_CALL(*p.ch, OnMessageMock(p.cs, _))
+      .Times(2)
+      .WillRepeatedly(WithArg<0>(SendRequest()));
+    EXPECT_CALL(*p.ch, OnMessageMock(p.cs, _))
+      .WillOnce(WithArg<0>(Disconnect()));
+  }
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(LNR_OK, p.cs.Connect().Code());
+  Request req(std::string(METHOD_NAME), Params());
+  ASSERT_EQ(LNR_OK, req.Send(p.cs).Code());
+
+  WAIT_TESTED();
+
+  ASSERT_TRUE(p.sh->m_ != NULL);
+  ASSERT_EQ(REQUEST, p.sh->m_->type);
+  Request recv_req = p.sh->m_->as<Request>();
+  ASSERT_EQ(std::string(METHOD_NAME), recv_req.method);
+  ASSERT_EQ(3u, p.cs.GetMetrics().recv_responses);
+}
+
+// The notify to enable method interning is not passed to handlers of the peer disabling it
+TEST_F(TCPClientServerSendRecvTest, MethodInterningOneSide) {
+  TCPPeers p;
+  ASSERT_EQ(LNR_OK, p.cs.SetMethodInterning(true).Code());
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  ExpectConnected(p);
+  EXPECT_CALL(*p.sh, OnMessageMock(Eq(ByRef(p.sh->s_)), _))
+    .WillOnce(WithArgs<0, 1>(SendResponse()));
+  EXPECT_CALL(*p.ch, OnMessageMock(p.cs, _))
+    .WillOnce(WithArg<0>(Disconnect()));
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(LNR_OK, ConnectAndWait(p).Code());
+  Request req(std::string(METHOD_NAME), Params());
+  ASSERT_EQ(LNR_OK, req.Send(p.cs).Code());
+
+  WAIT_TESTED();
+
+  ASSERT_TRUE(p.sh->m_ != NULL);
+  ASSERT_EQ(REQUEST, p.sh->m_->type);
+  ASSERT_EQ(std::string(METHOD_NAME), p.sh->m_->as<Request>().method);
+  ASSERT_EQ(1u, p.cs.GetMetrics().recv_responses);
+}
+
+ACTION(LeaveAllGroups) {
+  linear::Group::LeaveAll(arg0);
+}
+
+// A notify to a group is packed once and sent to every member, and a member left on disconnect gets no more
+TEST_F(TCPClientServerSendRecvTest, NotifyToGroupMembers) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch1 = linear::shared_ptr<MockHandler>(new MockHandler());
+  shared_ptr<MockHandler> ch2 = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl1(ch1), cl2(ch2);
+  TCPSocket cs1 = cl1.CreateSocket(TEST_ADDR, TEST_PORT);
+  TCPSocket cs2 = cl2.CreateSocket(TEST_ADDR, TEST_PORT);
+  bool notified1 = false, notified2 = false;
+  bool disconnected1 = false;
+  ASSERT_EQ(LNR_OK, StartServer(sv).Code());
+
+  EXPECT_CALL(*sh, OnConnectMock(_))
+    .Times(2)
+    .WillRepeatedly(WithArg<0>(JoinToGroup()));
+  {
+    InSequence dummy;
+    EXPECT_CALL(*sh, OnDisconnectMock(_, _))
+      .WillOnce(WithArg<0>(LeaveAllGroups()));
+    EXPECT_CALL(*sh, OnDisconnectMock(_, _))
+      .WillOnce(DoAll(WithArg<0>(LeaveAllGroups()), Assign(&srv_tested, true)));
+  }
+  EXPECT_CALL(*ch1, OnConnectMock(cs1));
+  EXPECT_CALL(*ch1, OnMessageMock(cs1, _))
+    .WillOnce(Assign(&notified1, true));
+  EXPECT_CALL(*ch1, OnDisconnectMock(cs1, _))
+    .WillOnce(Assign(&disconnected1, true));
+  EXPECT_CALL(*ch2, OnConnectMock(cs2));
+  {
+    InSequence dummy;
+    EXPECT_CALL(*ch2, OnMessageMock(cs2, _))
+      .WillOnce(Assign(&notified2, true));
+    EXPECT_CALL(*ch2, OnMessageMock(cs2, _))
+      .WillOnce(WithArg<0>(Disconnect()));
+    EXPECT_CALL(*ch2, OnDisconnectMock(cs2, _))
+      .WillOnce(Assign(&cli_tested, true));
+  }
+
+  ASSERT_EQ(LNR_OK, cs1.Connect().Code());
+  ASSERT_EQ(LNR_OK, cs2.Connect().Code());
+  while (Group::Members(GROUP_NAME)->size() < 2) {
+    msleep(1);
+  }
+  shared_ptr<const std::set<Socket> > members = Group::Members(GROUP_NAME);
+  Notify notify(std::string(METHOD_NAME), Params());
+  notify.Send(GROUP_NAME);
+  while (!notified1 || !notified2) {
+    msleep(1);
+  }
+  // every member sent the same bytes once
+  SocketMetrics m1 = members->begin()->GetMetrics();
+  SocketMetrics m2 = members->rbegin()->GetMetrics();
+  ASSERT_EQ(1u, m1.sent_notifies);
+  ASSERT_EQ(1u, m2.sent_notifies);
+  ASSERT_LT(0u, m1.sent_bytes);
+  ASSERT_EQ(m1.sent_bytes, m2.sent_bytes);
+
+  cs1.Disconnect();
+  while (!disconnected1 || Group::Members(GROUP_NAME)->size() > 1) {
+    msleep(1);
+  }
+  notify.Send(GROUP_NAME);
+  WAIT_TESTED();
+
+  ASSERT_EQ(2u, members->size()); // a snapshot taken before is not changed
+  ASSERT_EQ(0u, Group::Members(GROUP_NAME)->size());
+  type::any params = Params();
+  ASSERT_TRUE(ch1->m_ != NULL);
+  ASSERT_EQ(params, ch1->m_->as<Notify>().params);
+  ASSERT_TRUE(ch2->m_ != NULL);
+  ASSERT_EQ(params, ch2->m_->as<Notify>().params);
+}
+
+// Messages are sent through a socket created with a host name, which is resolved on Connect
+TEST_F(TCPClientServerSendRecvTest, RequestToHostName) {
+  TCPPeers p("localhost");
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  ExpectConnected(p);
+  EXPECT_CALL(*p.sh, OnMessageMock(Eq(ByRef(p.sh->s_)), _))
+    .WillOnce(WithArgs<0, 1>(SendResponse()));
+  EXPECT_CALL(*p.ch, OnMessageMock(p.cs, _))
+    .WillOnce(WithArgs<0>(Disconnect()));
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(LNR_OK, ConnectAndWait(p).Code());
+  Request req(std::string(METHOD_NAME), Params());
+  ASSERT_EQ(LNR_OK, req.Send(p.cs).Code());
+
+  WAIT_TESTED();
+
+  ASSERT_TRUE(p.ch->m_ != NULL);
+  ASSERT_EQ(RESPONSE, p.ch->m_->type);
+  ASSERT_EQ(req.msgid, p.ch->m_->as<Response>().request.msgid);
+  ASSERT_EQ(Addrinfo::IPv4, p.cs.GetPeerInfo().proto);
+}
+
+#ifdef WITH_ZLIB
+TEST_F(TCPClientServerSendRecvTest, Compression) {
+  TCPPeers p;
+  ASSERT_EQ(LNR_OK, p.cs.SetCompression(1024).Code());
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  EXPECT_CALL(*p.sh, OnConnectMock(_))
+    .WillOnce(WithArg<0>(EnableCompression(1024)));
+  // the notify to enable compression is not passed to handlers
+  EXPECT_CALL(*p.sh, OnMessageMock(Eq(ByRef(p.sh->s_)), _))
+    .Times(2)
+    .WillRepeatedly(WithArgs<0, 1>(SendResponse()));
+  EXPECT_CALL(*p.ch, OnConnectMock(p.cs));
+  {
+    InSequence dummy;
+    EXPECT_CALL(*p.ch, OnMessageMock(p.cs, _))
+      .WillOnce(WithArg<0>(SendCompressibleRequest()));
+    EXPECT_CALL(*p.ch, OnMessageMock(p.cs, _))
+      .WillOnce(WithArg<0>(Disconnect()));
+  }
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(LNR_OK, p.cs.Connect().Code());
+  Request req(std::string(METHOD_NAME), std::string(100000, 'a'));
+  ASSERT_EQ(LNR_OK, req.Send(p.cs).Code());
+
+  WAIT_TESTED();
+
+  ASSERT_TRUE(p.sh->m_ != NULL);
+  ASSERT_EQ(REQUEST, p.sh->m_->type);
+  Request recv_req = p.sh->m_->as<Request>();
+  ASSERT_EQ(std::string(100000, 'a'), recv_req.params.as<std::string>());
+  ASSERT_TRUE(p.ch->m_ != NULL);
+  ASSERT_EQ(RESPONSE, p.ch->m_->type);
+  Response resp = p.ch->m_->as<Response>();
+  ASSERT_EQ(recv_req.params, resp.result);
+  // 1st request is sent as is, because the notify from the server is not received yet
+  SocketMetrics metrics = p.cs.GetMetrics();
+  ASSERT_EQ(1u, metrics.sent_compressed);
+  ASSERT_EQ(2u, metrics.recv_compressed);
+  ASSERT_GT(metrics.sent_uncompressed_bytes, metrics.sent_compressed_bytes);
+  ASSERT_GT(metrics.recv_uncompressed_bytes, metrics.recv_compressed_bytes);
+}
+
+// The notify to enable compression is not passed to handlers of the peer disabling it,
+// and messages to the peer are not compressed
+TEST_F(TCPClientServerSendRecvTest, CompressionOneSide) {
+  TCPPeers p;
+  ASSERT_EQ(LNR_OK, p.cs.SetCompression(1024).Code());
+  ASSERT_EQ(LNR_OK, StartServer(p.sv).Code());
+
+  ExpectConnected(p);
+  EXPECT_CALL(*p.sh, OnMessageMock(Eq(ByRef(p.sh->s_)), _))
+    .WillOnce(WithArgs<0, 1>(SendResponse()));
+  EXPECT_CALL(*p.ch, OnMessageMock(p.cs, _))
+    .WillOnce(WithArg<0>(Disconnect()));
+  ExpectDisconnected(p);
+
+  ASSERT_EQ(LNR_OK, ConnectAndWait(p).Code());
+  Request req(std::string(METHOD_NAME), std::string(100000, 'a'));
+  ASSERT_EQ(LNR_OK, req.Send(p.cs).Code());
+
+  WAIT_TESTED();
+
+  ASSERT_TRUE(p.sh->m_ != NULL);
+  ASSERT_EQ(REQUEST, p.sh->m_->type);
+  ASSERT_EQ(std::string(100000, 'a'), p.sh->m_->as<Request>().params.as<std::string>());
+  SocketMetrics metrics = p.cs.GetMetrics();
+  ASSERT_EQ(0u, metrics.sent_compressed);
+  ASSERT_EQ(0u, metrics.recv_compressed);
+}
+
+// A notify to a group is packed and compressed once, and every member decompresses it
+TEST_F(TCPClientServerSendRecvTest, CompressionGroupNotify) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch1 = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl1(ch1);
+  TCPSocket cs1 = cl1.CreateSocket(TEST_ADDR, TEST_PORT);
+  ASSERT_EQ(LNR_OK, cs1.SetCompression(1024).Code());
+  shared_ptr<MockHandler> ch2 = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl2(ch2);
+  TCPSocket cs2 = cl2.CreateSocket(TEST_ADDR, TEST_PORT);
+  ASSERT_EQ(LNR_OK, cs2.SetCompression(1024).Code());
+  bool responded1 = false, responded2 = false;
+  bool notified1 = false, notified2 = false;
+  bool disconnected1 = false;
+
+  ASSERT_EQ(LNR_OK, StartServer(sv).Code());
+
+  // a request from each client makes sure that the server has received the notify to enable compression
+  EXPECT_CALL(*sh, OnConnectMock(_))
+    .Times(2)
+    .WillRepeatedly(DoAll(WithArg<0>(EnableCompression(1024)), WithArg<0>(JoinToGroup())));
+  EXPECT_CALL(*sh, OnMessageMock(_, _))
+    .Times(2)
+    .WillRepeatedly(WithArgs<0, 1>(SendResponse()));
+  {
+    InSequence dummy;
+    EXPECT_CALL(*sh, OnDisconnectMock(_, _))
+      .WillOnce(WithArg<0>(LeaveFromGroup()));
+    EXPECT_CALL(*sh, OnDisconnectMock(_, _))
+      .WillOnce(DoAll(WithArg<0>(LeaveFromGroup()), Assign(&srv_tested, true)));
+  }
+  {
+    InSequence dummy;
+    EXPECT_CALL(*ch1, OnConnectMock(cs1))
+      .WillOnce(WithArg<0>(SendRequest()));
+    EXPECT_CALL(*ch1, OnMessageMock(cs1, _))
+      .WillOnce(Assign(&responded1, true));
+    EXPECT_CALL(*ch1, OnMessageMock(cs1, _))
+      .WillOnce(Assign(&notified1, true));
+    EXPECT_CALL(*ch1, OnDisconnectMock(cs1, _))
+      .WillOnce(Assign(&disconnected1, true));
+  }
+  {
+    InSequence dummy;
+    EXPECT_CALL(*ch2, OnConnectMock(cs2))
+      .WillOnce(WithArg<0>(SendRequest()));
+    EXPECT_CALL(*ch2, OnMessageMock(cs2, _))
+      .WillOnce(Assign(&responded2, true));
+    EXPECT_CALL(*ch2, OnMessageMock(cs2, _))
+      .WillOnce(Assign(&notified2, true));
+    EXPECT_CALL(*ch2, OnDisconnectMock(cs2, _))
+      .WillOnce(Assign(&cli_tested, true));
+  }
+
+  ASSERT_EQ(LNR_OK, cs1.Connect().Code());
+  ASSERT_EQ(LNR_OK, cs2.Connect().Code());
+  while (!responded1 || !responded2) {
+    msleep(1);
+  }
+  Notify notify(std::string(METHOD_NAME), std::string(100000, 'a'));
+  notify.Send(GROUP_NAME);
+  while (!notified1 || !notified2) {
+    msleep(1);
+  }
+  cs1.Disconnect();
+  cs2.Disconnect();
+  WAIT_TESTED();
+  while (!disconnected1) {
+    msleep(1);
+  }
+
+  ASSERT_TRUE(ch1->m_ != NULL);
+  ASSERT_EQ(NOTIFY, ch1->m_->type);
+  ASSERT_EQ(std::string(100000, 'a'), ch1->m_->as<Notify>().params.as<std::string>());
+  ASSERT_TRUE(ch2->m_ != NULL);
+  ASSERT_EQ(NOTIFY, ch2->m_->type);
+  ASSERT_EQ(std::string(100000, 'a'), ch2->m_->as<Notify>().params.as<std::string>());
+  ASSERT_EQ(1u, cs1.GetMetrics().recv_compressed);
+  ASSERT_EQ(1u, cs2.GetMetrics().recv_compressed);
+  ASSERT_EQ(0u, Group::Members(GROUP_NAME)->size());
+}
+#else
+TEST_F(TCPClientServerSendRecvTest, CompressionNotSupported) {
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+  ASSERT_EQ(LNR_ENOTSUP, cs.SetCompression(1024).Code());
+  ASSERT_EQ(LNR_OK, cs.SetCompression(0).Code());
+}
+#endif
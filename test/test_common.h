@@ -87,6 +87,7 @@ class MockHandler : public linear::Handler {
   MOCK_METHOD2(OnDisconnectMock, void(const linear::Socket& s, const linear::Error& e));
   MOCK_METHOD2(OnMessageMock,    void(const linear::Socket& s, const linear::Message& m));
   MOCK_METHOD3(OnErrorMock,      void(const linear::Socket& s, const linear::Message& m, const linear::Error& e));
+  MOCK_METHOD1(OnWritableMock,   void(const linear::Socket& s));
 
   MockHandler() : m_(NULL), err_m_(NULL) {}
   virtual ~MockHandler() {
@@ -147,6 +148,9 @@ class MockHandler : public linear::Handler {
     }
     OnErrorMock(s, m, e);
   }
+  void OnWritable(const linear::Socket& s) {
+    OnWritableMock(s);
+  }
 
  public:
   linear::Socket s_;
@@ -270,6 +274,31 @@ ACTION_P2(MultiSendNotify, num, limit) {
     ASSERT_EQ(linear::Error(linear::LNR_OK), e);
   }
 }
+ACTION_P2(SendUntilWouldBlock, high, low) {
+  linear::Socket s = arg0;
+  ASSERT_EQ(linear::LNR_OK, s.SetSendWatermark(high, low).Code());
+  linear::Notify notify("test", std::string(10000, 'a'));
+  linear::Error e;
+  while ((e = notify.Send(s)) == linear::Error(linear::LNR_OK)) {
+    ASSERT_GT(static_cast<size_t>(high), s.GetSendQueueSize());
+  }
+  ASSERT_EQ(linear::LNR_EAGAIN, e.Code());
+  ASSERT_LE(static_cast<size_t>(high), s.GetSendQueueSize());
+}
+ACTION(EnableMethodInterning) {
+  linear::Socket s = arg0;
+  ASSERT_EQ(linear::LNR_OK, s.SetMethodInterning(true).Code());
+}
+ACTION_P(EnableCompression, threshold) {
+  linear::Socket s = arg0;
+  ASSERT_EQ(linear::LNR_OK, s.SetCompression(threshold).Code());
+}
+ACTION(SendCompressibleRequest) {
+  linear::Socket s = arg0;
+  linear::Request request(std::string(METHOD_NAME), std::string(100000, 'a'));
+  linear::Error e = request.Send(s);
+  ASSERT_EQ(linear::LNR_OK, e.Code());
+}
 ACTION(CheckEbusy) {
   linear::Error e = arg0;
   ASSERT_EQ(linear::Error(linear::LNR_EBUSY), e);
@@ -4,6 +4,7 @@
 
 #include <unistd.h>
 
+#include "linear/event_loop.h"
 #include "linear/timer.h"
 
 typedef LinearTest TimerTest;
@@ -141,3 +142,24 @@ TEST_F(TimerTest, newdeleteLoop) {
 
   timer.Stop();
 }
+
+void blockOnTimer(void* args) {
+  usleep(*reinterpret_cast<int*>(args) * 1000);
+}
+
+// lag is seen while the loop is blocked, and goes back after the loop gets idle
+TEST_F(TimerTest, loopLag) {
+  linear::EventLoop::GetDefault().GetMetrics(); // start sampling
+  int block_msec = 1500;
+  linear::Timer timer;
+  timer.Start(blockOnTimer, 0, &block_msec);
+  usleep(1300 * 1000);
+  linear::EventLoopMetrics metrics = linear::EventLoop::GetDefault().GetMetrics();
+  ASSERT_LE(200u, metrics.lag); // the probe is overdue
+  ASSERT_LE(metrics.lag, metrics.max_lag);
+
+  usleep(1700 * 1000);
+  metrics = linear::EventLoop::GetDefault().GetMetrics();
+  ASSERT_GT(100u, metrics.lag); // the probe fired on time after blocked
+  ASSERT_LE(200u, metrics.max_lag);
+}
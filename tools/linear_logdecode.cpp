@@ -0,0 +1,325 @@
+// render binary logs written by linear::log::EnableBinaryFile as text
+//
+// usage: linear_logdecode [file]
+// read stdin when file is omitted
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "linear/any.h"
+
+#include "log_binary.h"
+
+using namespace linear::log;
+
+struct Format {
+  int32_t line;
+  std::string file;
+  std::string func;
+  std::string format;
+};
+
+static bool Read(FILE* fp, void* data, size_t size) {
+  return (size == 0 || fread(data, 1, size, fp) == size);
+}
+
+template <typename T>
+static bool Read(FILE* fp, T* value) {
+  return Read(fp, value, sizeof(*value));
+}
+
+static bool ReadString(FILE* fp, std::string* str) {
+  uint32_t size;
+  if (!Read(fp, &size)) {
+    return false;
+  }
+  str->resize(size);
+  return (size == 0 || Read(fp, &(*str)[0], size));
+}
+
+// sequential reader of the args of a record
+class Args {
+ public:
+  explicit Args(const std::string& body) : body_(body), pos_(0) {}
+  bool Next(char expected, void* value, size_t size) {
+    if (pos_ + 1 + size > body_.size() || body_[pos_] != expected) {
+      return false;
+    }
+    memcpy(value, body_.data() + pos_ + 1, size);
+    pos_ += 1 + size;
+    return true;
+  }
+  bool NextString(char expected, std::string* value) {
+    uint32_t size;
+    if (!Next(expected, &size, sizeof(size)) || pos_ + size > body_.size()) {
+      return false;
+    }
+    value->assign(body_.data() + pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+ private:
+  const std::string& body_;
+  size_t pos_;
+};
+
+static std::string VFormat(const char* format, va_list args) {
+  std::vector<char> buffer(LOG_BUFSIZ);
+  va_list copy;
+  va_copy(copy, args);
+  int n = vsnprintf(&buffer[0], buffer.size(), format, copy);
+  va_end(copy);
+  if (n < 0) {
+    return std::string();
+  }
+  if (static_cast<size_t>(n) >= buffer.size()) {
+    buffer.resize(n + 1);
+    vsnprintf(&buffer[0], buffer.size(), format, args);
+  }
+  return std::string(&buffer[0], n);
+}
+
+static std::string Sprintf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  std::string str = VFormat(format, args);
+  va_end(args);
+  return str;
+}
+
+template <typename T>
+static std::string Sprintf(const std::string& format, int stars, const int* star, T value) {
+  switch(stars) {
+  case 0:
+    return Sprintf(format.c_str(), value);
+  case 1:
+    return Sprintf(format.c_str(), star[0], value);
+  default:
+    return Sprintf(format.c_str(), star[0], star[1], value);
+  }
+}
+
+// render the msgpack bytes of a blob in the same way as linear::type::any::stringify
+static std::string RenderBlob(const std::string& blob) {
+  try {
+    msgpack::object_handle handle;
+    size_t offset = 0;
+    msgpack::unpack(handle, blob.data(), blob.size(), offset);
+    return linear::type::any(handle.get(), linear::shared_ptr<msgpack::zone>()).stringify();
+  } catch (...) {
+    return Sprintf("(%u bytes of truncated msgpack)", static_cast<unsigned int>(blob.size()));
+  }
+}
+
+// format the message in the same way as printf, with the recorded args
+static bool Render(const std::string& format, const std::string& body, std::string* message) {
+  Args args(body);
+  FormatSpec spec;
+  const char* p = format.c_str();
+  while (NextFormatSpec(p, &spec)) {
+    message->append(p, spec.spec);
+    p = spec.end;
+    if (spec.type == 0) {
+      if (spec.conversion == '%') {
+        message->append("%");
+      } else if (spec.conversion != 'n') {
+        message->append(spec.spec, spec.end);
+      }
+      continue;
+    }
+    int star[2] = {0, 0};
+    for (int i = 0; i < spec.stars && i < 2; i++) {
+      int64_t value;
+      if (!args.Next(LOG_BINARY_INT, &value, sizeof(value))) {
+        return false;
+      }
+      star[i] = static_cast<int>(value);
+    }
+    std::string flags(spec.spec, spec.length);
+    switch(spec.type) {
+    case LOG_BINARY_INT:
+      {
+        int64_t value;
+        if (!args.Next(LOG_BINARY_INT, &value, sizeof(value))) {
+          return false;
+        }
+        if (spec.conversion == 'c') {
+          message->append(Sprintf(flags + "c", spec.stars, star, static_cast<int>(value)));
+        } else {
+          message->append(Sprintf(flags + "ll" + spec.conversion, spec.stars, star, static_cast<long long>(value)));
+        }
+      }
+      break;
+    case LOG_BINARY_UINT:
+      {
+        uint64_t value;
+        if (!args.Next(LOG_BINARY_UINT, &value, sizeof(value))) {
+          return false;
+        }
+        message->append(Sprintf(flags + "ll" + spec.conversion, spec.stars, star,
+                                static_cast<unsigned long long>(value)));
+      }
+      break;
+    case LOG_BINARY_DOUBLE:
+      {
+        double value;
+        if (!args.Next(LOG_BINARY_DOUBLE, &value, sizeof(value))) {
+          return false;
+        }
+        message->append(Sprintf(flags + spec.conversion, spec.stars, star, value));
+      }
+      break;
+    case LOG_BINARY_POINTER:
+      {
+        uint64_t value;
+        if (!args.Next(LOG_BINARY_POINTER, &value, sizeof(value))) {
+          return false;
+        }
+        message->append(Sprintf("0x%llx", static_cast<unsigned long long>(value)));
+      }
+      break;
+    case LOG_BINARY_STRING:
+      {
+        std::string value;
+        if (args.NextString(LOG_BINARY_BLOB, &value)) {
+          value = RenderBlob(value);
+        } else if (!args.NextString(LOG_BINARY_STRING, &value)) {
+          return false;
+        }
+        message->append(Sprintf(flags + "s", spec.stars, star, value.c_str()));
+      }
+      break;
+    default:
+      return false;
+    }
+  }
+  message->append(p);
+  return true;
+}
+
+static std::string GetDateTime(uint64_t usec) {
+  char datetime_str[32];
+  time_t sec = static_cast<time_t>(usec / 1000000);
+  struct tm ts;
+#ifdef _WIN32
+  struct tm* ret = (localtime_s(&ts, &sec) == 0) ? &ts : NULL;
+#else
+  struct tm* ret = localtime_r(&sec, &ts);
+#endif
+  if (ret == NULL) {
+    return std::string("ERR: fail to get date");
+  }
+  snprintf(datetime_str, sizeof(datetime_str),
+           "%d-%02d-%02d %02d:%02d:%02d.%03d",
+           ts.tm_year + 1900, ts.tm_mon + 1, ts.tm_mday,
+           ts.tm_hour, ts.tm_min, ts.tm_sec,
+           static_cast<int>((usec % 1000000) / 1000));
+  return std::string(datetime_str);
+}
+
+static const char* GetLevelString(int level) {
+#define LINEAR_LOG_LEVEL_CASE_GEN(IDENT, NUM, LONG_STR, SHORT_STR, COLOR)     \
+  case IDENT:                                                                 \
+    return SHORT_STR;
+
+  switch(level) {
+    LINEAR_LOG_LEVEL_MAP(LINEAR_LOG_LEVEL_CASE_GEN)
+  default:
+    return "";
+  }
+#undef LINEAR_LOG_LEVEL_CASE_GEN
+}
+
+static int Decode(FILE* fp) {
+  uint32_t magic, version;
+  uint64_t wall_clock, monotonic_clock;
+  if (!Read(fp, &magic) || !Read(fp, &version) || !Read(fp, &wall_clock) || !Read(fp, &monotonic_clock)) {
+    fprintf(stderr, "not a binary log\n");
+    return 1;
+  }
+  if (magic != LOG_BINARY_MAGIC) {
+    fprintf(stderr, "not a binary log, or written on a host of different byte order\n");
+    return 1;
+  }
+  if (version != LOG_BINARY_VERSION) {
+    fprintf(stderr, "unsupported version: %u\n", version);
+    return 1;
+  }
+
+  std::map<uint32_t, Format> formats;
+  uint8_t type;
+  while (Read(fp, &type)) {
+    if (type == LOG_BINARY_FORMAT) {
+      uint32_t id;
+      Format format;
+      if (!Read(fp, &id) || !Read(fp, &format.line) ||
+          !ReadString(fp, &format.file) || !ReadString(fp, &format.func) || !ReadString(fp, &format.format)) {
+        fprintf(stderr, "truncated format record\n");
+        return 1;
+      }
+      formats[id] = format;
+    } else if (type == LOG_BINARY_RECORD) {
+      uint32_t id, size;
+      uint8_t level, debug;
+      uint64_t clock;
+      std::string body;
+      if (!Read(fp, &id) || !Read(fp, &level) || !Read(fp, &debug) || !Read(fp, &clock) || !Read(fp, &size)) {
+        fprintf(stderr, "truncated record\n");
+        return 1;
+      }
+      body.resize(size);
+      if (size > 0 && !Read(fp, &body[0], size)) {
+        fprintf(stderr, "truncated record\n");
+        return 1;
+      }
+      std::map<uint32_t, Format>::iterator it = formats.find(id);
+      if (it == formats.end()) {
+        fprintf(stderr, "unknown format id: %u\n", id);
+        return 1;
+      }
+      const Format& format = it->second;
+      std::string message;
+      if (!Render(format.format, body, &message)) {
+        message = "(broken args) " + format.format;
+      }
+      std::string::size_type n = format.file.find_last_of("/\\");
+      printf("%s: [%s] (%s:%d) %s\n",
+             GetDateTime(wall_clock + (clock - monotonic_clock) / 1000).c_str(),
+             GetLevelString(level),
+             (n == std::string::npos) ? format.file.c_str() : format.file.substr(n + 1).c_str(),
+             format.line,
+             message.c_str());
+    } else {
+      fprintf(stderr, "unknown record type: %u\n", type);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [file]\n", argv[0]);
+    return 1;
+  }
+  FILE* fp = stdin;
+  if (argc == 2) {
+    fp = fopen(argv[1], "rb");
+    if (fp == NULL) {
+      fprintf(stderr, "fail to open %s\n", argv[1]);
+      return 1;
+    }
+  }
+  int ret = Decode(fp);
+  if (fp != stdin) {
+    fclose(fp);
+  }
+  return ret;
+}